@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+// Wrappers of the MPI functions used by deal.II for the ghost exchange and
+// the reductions, based on the MPI profiling interface. They count the sent
+// messages and bytes and the time spent waiting for the kernel that is
+// currently active, see CommunicationScope.
+
+#include <mpi.h>
+
+#include "include/communication.h"
+#include "include/trace.h"
+
+namespace
+{
+  using namespace dealii;
+
+  CommunicationCounter &
+  counter()
+  {
+    return communication_counters()[static_cast<unsigned int>(
+      current_communication_kernel())];
+  }
+
+  void
+  count_message(int const count, MPI_Datatype const datatype)
+  {
+    int size = 0;
+    PMPI_Type_size(datatype, &size);
+    ++counter().n_messages;
+    counter().n_bytes += static_cast<unsigned long long>(count) * size;
+  }
+
+  // Adds the wall time of the lifetime of this object to the wait time and
+  // to the timeline, if tracing is enabled
+  class WaitTimer
+  {
+  public:
+    WaitTimer()
+      : start(PMPI_Wtime())
+      , trace_start(TraceRecorder::instance().is_enabled() ?
+                      TraceRecorder::instance().now() :
+                      -1.0)
+    {}
+
+    ~WaitTimer()
+    {
+      counter().wait_time += PMPI_Wtime() - start;
+      if (trace_start >= 0.0 && TraceRecorder::instance().is_enabled())
+        TraceRecorder::instance().complete("mpi_wait",
+                                           "mpi",
+                                           trace_start,
+                                           TraceRecorder::instance().now());
+    }
+
+  private:
+    double const start;
+    double const trace_start;
+  };
+} // namespace
+
+extern "C"
+{
+  int
+  MPI_Send(const void  *buf,
+           int          count,
+           MPI_Datatype datatype,
+           int          dest,
+           int          tag,
+           MPI_Comm     comm)
+  {
+    count_message(count, datatype);
+    WaitTimer const timer;
+    return PMPI_Send(buf, count, datatype, dest, tag, comm);
+  }
+
+  int
+  MPI_Isend(const void  *buf,
+            int          count,
+            MPI_Datatype datatype,
+            int          dest,
+            int          tag,
+            MPI_Comm     comm,
+            MPI_Request *request)
+  {
+    count_message(count, datatype);
+    return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+  }
+
+  int
+  MPI_Recv(void        *buf,
+           int          count,
+           MPI_Datatype datatype,
+           int          source,
+           int          tag,
+           MPI_Comm     comm,
+           MPI_Status  *status)
+  {
+    WaitTimer const timer;
+    return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+  }
+
+  int
+  MPI_Wait(MPI_Request *request, MPI_Status *status)
+  {
+    WaitTimer const timer;
+    return PMPI_Wait(request, status);
+  }
+
+  int
+  MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[])
+  {
+    WaitTimer const timer;
+    return PMPI_Waitall(count, requests, statuses);
+  }
+
+  int
+  MPI_Waitany(int         count,
+              MPI_Request requests[],
+              int        *index,
+              MPI_Status *status)
+  {
+    WaitTimer const timer;
+    return PMPI_Waitany(count, requests, index, status);
+  }
+
+  int
+  MPI_Allreduce(const void  *sendbuf,
+                void        *recvbuf,
+                int          count,
+                MPI_Datatype datatype,
+                MPI_Op       op,
+                MPI_Comm     comm)
+  {
+    count_message(count, datatype);
+    WaitTimer const timer;
+    return PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+  }
+
+  int
+  MPI_Barrier(MPI_Comm comm)
+  {
+    ++counter().n_messages;
+    WaitTimer const timer;
+    return PMPI_Barrier(comm);
+  }
+}
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#include "include/fe_time.h"
+
+namespace dealii
+{
+  template std::array<FullMatrix<double>, 3>
+  get_dg_weights<double>(unsigned int const);
+  template std::array<FullMatrix<float>, 3>
+  get_dg_weights<float>(unsigned int const);
+  template std::array<FullMatrix<double>, 2>
+  get_cg_weights<double>(unsigned int const);
+  template std::array<FullMatrix<float>, 2>
+  get_cg_weights<float>(unsigned int const);
+
+  template std::array<FullMatrix<double>, 4>
+  get_fe_time_weights<double>(TimeStepType,
+                              unsigned int const,
+                              double,
+                              unsigned int);
+  template std::array<FullMatrix<float>, 4>
+  get_fe_time_weights<float>(TimeStepType,
+                             unsigned int const,
+                             double,
+                             unsigned int);
+  template std::vector<std::array<FullMatrix<double>, 4>>
+  get_fe_time_weights<double, double>(TimeStepType,
+                                      unsigned int,
+                                      double,
+                                      unsigned int,
+                                      std::vector<TimeMGType> const &);
+  template std::vector<std::array<FullMatrix<float>, 4>>
+  get_fe_time_weights<double, float>(TimeStepType,
+                                     unsigned int,
+                                     double,
+                                     unsigned int,
+                                     std::vector<TimeMGType> const &);
+
+  template std::array<FullMatrix<double>, 5>
+  get_fe_time_weights_wave<double>(TimeStepType,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   unsigned int);
+  template std::array<FullMatrix<float>, 5>
+  get_fe_time_weights_wave<float>(TimeStepType,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  unsigned int);
+  template std::vector<std::array<FullMatrix<double>, 5>>
+  get_fe_time_weights_wave<double, double>(TimeStepType,
+                                           unsigned int,
+                                           double,
+                                           unsigned int,
+                                           std::vector<TimeMGType> const &);
+  template std::vector<std::array<FullMatrix<float>, 5>>
+  get_fe_time_weights_wave<double, float>(TimeStepType,
+                                          unsigned int,
+                                          double,
+                                          unsigned int,
+                                          std::vector<TimeMGType> const &);
+
+  template FullMatrix<double>
+  get_time_evaluation_matrix<double>(
+    std::vector<Polynomials::Polynomial<double>> const &,
+    unsigned int);
+  template FullMatrix<double>
+  get_time_legendre_matrix<double>(
+    std::vector<Polynomials::Polynomial<double>> const &);
+  template FullMatrix<double>
+  get_time_projection_matrix<double>(TimeStepType,
+                                     unsigned int const,
+                                     unsigned int const,
+                                     unsigned int const);
+  template FullMatrix<float>
+  get_time_projection_matrix<float>(TimeStepType,
+                                    unsigned int const,
+                                    unsigned int const,
+                                    unsigned int const);
+  template FullMatrix<double>
+  get_time_prolongation_matrix<double>(TimeStepType,
+                                       unsigned int const,
+                                       unsigned int const);
+  template FullMatrix<float>
+  get_time_prolongation_matrix<float>(TimeStepType,
+                                      unsigned int const,
+                                      unsigned int const);
+  template FullMatrix<double>
+  get_time_restriction_matrix<double>(TimeStepType,
+                                      unsigned int const,
+                                      unsigned int const);
+  template FullMatrix<float>
+  get_time_restriction_matrix<float>(TimeStepType,
+                                     unsigned int const,
+                                     unsigned int const);
+} // namespace dealii
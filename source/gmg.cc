@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#include "include/gmg.h"
+#include "include/operators.h"
+#include "include/time_integrators.h"
+
+namespace dealii
+{
+  template class VankaPatchData<double>;
+  template class PreconditionVanka<double>;
+  template class MGTwoLevelTransferST<double>;
+  template class VankaPatchData<float>;
+  template class PreconditionVanka<float>;
+  template class MGTwoLevelTransferST<float>;
+
+  template class MGTwoLevelBlockTransfer<2, double>;
+  template class TwoLevelTransferOperator<2, double>;
+  template class STMGTransferBlockMatrixFree<2, double>;
+  template VankaPatchData<double>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<2>> const &,
+    std::vector<DoFHandler<2>::cell_iterator> const &);
+  template PreconditionVanka<double>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<double> &,
+    const FullMatrix<double> &,
+    std::shared_ptr<const DoFHandler<2>> const &);
+
+  template class MGTwoLevelBlockTransfer<2, float>;
+  template class TwoLevelTransferOperator<2, float>;
+  template class STMGTransferBlockMatrixFree<2, float>;
+  template VankaPatchData<float>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<2>> const &,
+    std::vector<DoFHandler<2>::cell_iterator> const &);
+  template PreconditionVanka<float>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<float> &,
+    const FullMatrix<float> &,
+    std::shared_ptr<const DoFHandler<2>> const &);
+
+  template class MGTwoLevelBlockTransfer<3, double>;
+  template class TwoLevelTransferOperator<3, double>;
+  template class STMGTransferBlockMatrixFree<3, double>;
+  template VankaPatchData<double>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<3>> const &,
+    std::vector<DoFHandler<3>::cell_iterator> const &);
+  template PreconditionVanka<double>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<double> &,
+    const FullMatrix<double> &,
+    std::shared_ptr<const DoFHandler<3>> const &);
+
+  template class MGTwoLevelBlockTransfer<3, float>;
+  template class TwoLevelTransferOperator<3, float>;
+  template class STMGTransferBlockMatrixFree<3, float>;
+  template VankaPatchData<float>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<3>> const &,
+    std::vector<DoFHandler<3>::cell_iterator> const &);
+  template PreconditionVanka<float>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<float> &,
+    const FullMatrix<float> &,
+    std::shared_ptr<const DoFHandler<3>> const &);
+
+  template MatrixFreeGMG<2, double>::GMG(
+    TimerOutput &,
+    Parameters<2> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<2> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<2>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<double>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<2, double>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<double>>> &,
+    std::unique_ptr<BlockVectorT<double>> &&,
+    std::unique_ptr<BlockVectorT<double>> &&);
+  template void
+  MatrixFreeGMG<2, double>::reinit() const;
+  template std::unique_ptr<const MatrixFreeGMG<2, double>>
+  MatrixFreeGMG<2, double>::clone(TimerOutput &) const;
+  template double
+  MatrixFreeGMG<2, double>::estimate_relaxation(unsigned) const;
+  template void
+  MatrixFreeGMG<2, double>::setup_multigrid() const;
+  template void
+  MatrixFreeGMG<2, double>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+
+  template MatrixFreeGMG<2, float>::GMG(
+    TimerOutput &,
+    Parameters<2> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<2> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<2>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<float>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<2, float>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<float>>> &,
+    std::unique_ptr<BlockVectorT<float>> &&,
+    std::unique_ptr<BlockVectorT<float>> &&);
+  template void
+  MatrixFreeGMG<2, float>::reinit() const;
+  template std::unique_ptr<const MatrixFreeGMG<2, float>>
+  MatrixFreeGMG<2, float>::clone(TimerOutput &) const;
+  template double
+  MatrixFreeGMG<2, float>::estimate_relaxation(unsigned) const;
+  template void
+  MatrixFreeGMG<2, float>::setup_multigrid() const;
+  template void
+  MatrixFreeGMG<2, float>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+  template void
+  MatrixFreeGMG<2, float>::vmult<BlockVectorT<float>>(
+    BlockVectorT<float> &,
+    const BlockVectorT<float> &) const;
+
+  template MatrixFreeGMG<3, double>::GMG(
+    TimerOutput &,
+    Parameters<3> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<3> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<3>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<double>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<3, double>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<double>>> &,
+    std::unique_ptr<BlockVectorT<double>> &&,
+    std::unique_ptr<BlockVectorT<double>> &&);
+  template void
+  MatrixFreeGMG<3, double>::reinit() const;
+  template std::unique_ptr<const MatrixFreeGMG<3, double>>
+  MatrixFreeGMG<3, double>::clone(TimerOutput &) const;
+  template double
+  MatrixFreeGMG<3, double>::estimate_relaxation(unsigned) const;
+  template void
+  MatrixFreeGMG<3, double>::setup_multigrid() const;
+  template void
+  MatrixFreeGMG<3, double>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+
+  template MatrixFreeGMG<3, float>::GMG(
+    TimerOutput &,
+    Parameters<3> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<3> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<3>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<float>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<3, float>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<float>>> &,
+    std::unique_ptr<BlockVectorT<float>> &&,
+    std::unique_ptr<BlockVectorT<float>> &&);
+  template void
+  MatrixFreeGMG<3, float>::reinit() const;
+  template std::unique_ptr<const MatrixFreeGMG<3, float>>
+  MatrixFreeGMG<3, float>::clone(TimerOutput &) const;
+  template double
+  MatrixFreeGMG<3, float>::estimate_relaxation(unsigned) const;
+  template void
+  MatrixFreeGMG<3, float>::setup_multigrid() const;
+  template void
+  MatrixFreeGMG<3, float>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+  template void
+  MatrixFreeGMG<3, float>::vmult<BlockVectorT<float>>(
+    BlockVectorT<float> &,
+    const BlockVectorT<float> &) const;
+} // namespace dealii
@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#include "include/operators.h"
+
+namespace dealii
+{
+  template class MatrixFreeOperator<2, double>;
+  template class MatrixFreeOperator<2, float>;
+  template class MatrixFreeOperator<3, double>;
+  template class MatrixFreeOperator<3, float>;
+  template class SystemMatrix<double, MatrixFreeOperator<2, double>>;
+  template class SystemMatrix<float, MatrixFreeOperator<2, float>>;
+  template class SystemMatrix<double, MatrixFreeOperator<3, double>>;
+  template class SystemMatrix<float, MatrixFreeOperator<3, float>>;
+} // namespace dealii
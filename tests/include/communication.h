@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#pragma once
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/table_handler.h>
+
+#include <deal.II/multigrid/mg_base.h>
+
+#include <array>
+#include <memory>
+
+namespace dealii
+{
+  /** Logical kernels the communication is attributed to. A scope only
+   * takes effect if its kernel comes later in this list than the current
+   * one. A Krylov scope thus covers all reductions of the slab solver.
+   * Everything called in the coarse grid solver is attributed to it.
+   */
+  enum class CommunicationKernel : unsigned int
+  {
+    other    = 0,
+    krylov   = 1,
+    vanka    = 2,
+    transfer = 3,
+    matvec   = 4,
+    coarse   = 5,
+  };
+
+  inline constexpr unsigned int n_communication_kernels = 6;
+
+  inline constexpr std::array<char const *, n_communication_kernels>
+    communication_kernel_names = {
+      {"other", "krylov", "vanka", "transfer", "matvec", "coarse"}};
+
+  struct CommunicationCounter
+  {
+    unsigned long long n_messages = 0;
+    unsigned long long n_bytes    = 0;
+    double             wait_time  = 0.0;
+  };
+
+  /** Counters per kernel, filled by the MPI wrappers in
+   * source/communication.cc if LOD_PROFILE_MPI is set. Sent messages and
+   * bytes are counted for point-to-point and collective operations, the
+   * wait time is the time spent in blocking calls and waits.
+   */
+  inline std::array<CommunicationCounter, n_communication_kernels> &
+  communication_counters()
+  {
+    static std::array<CommunicationCounter, n_communication_kernels> counters;
+    return counters;
+  }
+
+  inline CommunicationKernel &
+  current_communication_kernel()
+  {
+    thread_local CommunicationKernel kernel = CommunicationKernel::other;
+    return kernel;
+  }
+
+  /** Attribute the communication in the lifetime of this object to kernel.
+   * Without LOD_PROFILE_MPI, this does nothing.
+   */
+  class CommunicationScope
+  {
+  public:
+#ifdef LOD_PROFILE_MPI
+    explicit CommunicationScope(CommunicationKernel const kernel)
+      : previous(current_communication_kernel())
+    {
+      if (kernel > previous)
+        current_communication_kernel() = kernel;
+    }
+
+    ~CommunicationScope()
+    {
+      current_communication_kernel() = previous;
+    }
+
+  private:
+    CommunicationKernel const previous;
+#else
+    explicit CommunicationScope(CommunicationKernel const)
+    {}
+#endif
+  };
+
+  /** Coarse grid solver that attributes its communication to the coarse
+   * solve
+   */
+  template <typename VectorType>
+  class MGCoarseGridProfiled final : public MGCoarseGridBase<VectorType>
+  {
+  public:
+    MGCoarseGridProfiled(std::unique_ptr<MGCoarseGridBase<VectorType>> &&inner)
+      : inner(std::move(inner))
+    {}
+
+    void
+    operator()(unsigned int const level,
+               VectorType        &dst,
+               VectorType const  &src) const override
+    {
+      CommunicationScope scope(CommunicationKernel::coarse);
+      (*inner)(level, dst, src);
+    }
+
+  private:
+    std::unique_ptr<MGCoarseGridBase<VectorType>> inner;
+  };
+
+  /** Print the messages and bytes sent per kernel, summed over all ranks,
+   * and the minimum, average and maximum wait time over the ranks, and
+   * reset the counters. Without LOD_PROFILE_MPI, nothing is printed.
+   */
+  inline void
+  print_communication_statistics(ConditionalOStream &pcout,
+                                 MPI_Comm const      comm)
+  {
+#ifdef LOD_PROFILE_MPI
+    // The reductions below are not counted
+    auto const counters = communication_counters();
+
+    TableHandler table;
+    for (unsigned int k = 0; k < n_communication_kernels; ++k)
+      {
+        auto const wait_time =
+          Utilities::MPI::min_max_avg(counters[k].wait_time, comm);
+        table.add_value("kernel", std::string(communication_kernel_names[k]));
+        table.add_value("messages",
+                        Utilities::MPI::sum(counters[k].n_messages, comm));
+        table.add_value("bytes",
+                        Utilities::MPI::sum(counters[k].n_bytes, comm));
+        table.add_value("wait_min", wait_time.min);
+        table.add_value("wait_avg", wait_time.avg);
+        table.add_value("wait_max", wait_time.max);
+      }
+    for (auto const &column : {"wait_min", "wait_avg", "wait_max"})
+      {
+        table.set_precision(column, 3);
+        table.set_scientific(column, true);
+      }
+    if (pcout.is_active())
+      table.write_text(pcout.get_stream());
+    pcout << std::endl;
+
+    communication_counters().fill(CommunicationCounter());
+#else
+    (void)pcout;
+    (void)comm;
+#endif
+  }
+} // namespace dealii
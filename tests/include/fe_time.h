@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <deal.II/base/polynomial.h>
 #include <deal.II/base/quadrature_lib.h>
 
 #include <deal.II/fe/fe_dgq.h>
@@ -266,6 +267,37 @@ namespace dealii
     return time_evaluator;
   }
 
+  /** Coefficients of the polynomial with the given values in basis with
+   * respect to the orthonormal Legendre polynomials on the unit interval.
+   * Row m belongs to the Legendre polynomial of degree m, so the sum of the
+   * squared coefficients is the squared L2 norm of the polynomial.
+   */
+  template <typename Number>
+  FullMatrix<Number>
+  get_time_legendre_matrix(
+    std::vector<Polynomials::Polynomial<double>> const &basis)
+  {
+    unsigned int const n = basis.size();
+    QGauss<1> const    quad(n);
+    FullMatrix<Number> legendre(n, n);
+    for (unsigned int m = 0; m < n; ++m)
+      {
+        Polynomials::Legendre const p(m);
+        double                      norm = 0.0;
+        for (unsigned int q = 0; q < quad.size(); ++q)
+          norm += quad.weight(q) * std::pow(p.value(quad.point(q)[0]), 2);
+        for (unsigned int i = 0; i < n; ++i)
+          {
+            double c = 0.0;
+            for (unsigned int q = 0; q < quad.size(); ++q)
+              c += quad.weight(q) * p.value(quad.point(q)[0]) *
+                   basis[i].value(quad.point(q)[0]);
+            legendre(m, i) = c / std::sqrt(norm);
+          }
+      }
+    return legendre;
+  }
+
   /** Generates the time integration weights for time continuous
    * Galerkin-Petrov discretizations or time discontinuous Galerkin
    * discretizations
@@ -411,7 +443,7 @@ namespace dealii
     return time_weights_wave;
   }
 
-  std::vector<Polynomials::Polynomial<double>>
+  inline std::vector<Polynomials::Polynomial<double>>
   get_time_basis(TimeStepType type, unsigned int const r)
   {
     if (type == TimeStepType::CGP)
@@ -554,7 +586,7 @@ namespace dealii
     return {{lhs_matrix, lhs_matrix_der, jump_matrix}};
   }
 
-  std::vector<size_t>
+  inline std::vector<size_t>
   get_fe_q_permutation(FE_Q<1> const &fe_time)
   {
     size_t const        n_dofs = fe_time.n_dofs_per_cell();
@@ -715,4 +747,99 @@ namespace dealii
     return restriction_n;
   }
 
+#ifdef LOD_PRECOMPILED_KERNELS
+  // Instantiated in source/fe_time.cc
+  extern template std::array<FullMatrix<double>, 3>
+  get_dg_weights<double>(unsigned int const);
+  extern template std::array<FullMatrix<float>, 3>
+  get_dg_weights<float>(unsigned int const);
+  extern template std::array<FullMatrix<double>, 2>
+  get_cg_weights<double>(unsigned int const);
+  extern template std::array<FullMatrix<float>, 2>
+  get_cg_weights<float>(unsigned int const);
+
+  extern template std::array<FullMatrix<double>, 4>
+  get_fe_time_weights<double>(TimeStepType,
+                              unsigned int const,
+                              double,
+                              unsigned int);
+  extern template std::array<FullMatrix<float>, 4>
+  get_fe_time_weights<float>(TimeStepType,
+                             unsigned int const,
+                             double,
+                             unsigned int);
+  extern template std::vector<std::array<FullMatrix<double>, 4>>
+  get_fe_time_weights<double, double>(TimeStepType,
+                                      unsigned int,
+                                      double,
+                                      unsigned int,
+                                      std::vector<TimeMGType> const &);
+  extern template std::vector<std::array<FullMatrix<float>, 4>>
+  get_fe_time_weights<double, float>(TimeStepType,
+                                     unsigned int,
+                                     double,
+                                     unsigned int,
+                                     std::vector<TimeMGType> const &);
+
+  extern template std::array<FullMatrix<double>, 5>
+  get_fe_time_weights_wave<double>(TimeStepType,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   FullMatrix<double> const &,
+                                   unsigned int);
+  extern template std::array<FullMatrix<float>, 5>
+  get_fe_time_weights_wave<float>(TimeStepType,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  FullMatrix<float> const &,
+                                  unsigned int);
+  extern template std::vector<std::array<FullMatrix<double>, 5>>
+  get_fe_time_weights_wave<double, double>(TimeStepType,
+                                           unsigned int,
+                                           double,
+                                           unsigned int,
+                                           std::vector<TimeMGType> const &);
+  extern template std::vector<std::array<FullMatrix<float>, 5>>
+  get_fe_time_weights_wave<double, float>(TimeStepType,
+                                          unsigned int,
+                                          double,
+                                          unsigned int,
+                                          std::vector<TimeMGType> const &);
+
+  extern template FullMatrix<double>
+  get_time_evaluation_matrix<double>(
+    std::vector<Polynomials::Polynomial<double>> const &,
+    unsigned int);
+  extern template FullMatrix<double>
+  get_time_legendre_matrix<double>(
+    std::vector<Polynomials::Polynomial<double>> const &);
+  extern template FullMatrix<double>
+  get_time_projection_matrix<double>(TimeStepType,
+                                     unsigned int const,
+                                     unsigned int const,
+                                     unsigned int const);
+  extern template FullMatrix<float>
+  get_time_projection_matrix<float>(TimeStepType,
+                                    unsigned int const,
+                                    unsigned int const,
+                                    unsigned int const);
+  extern template FullMatrix<double>
+  get_time_prolongation_matrix<double>(TimeStepType,
+                                       unsigned int const,
+                                       unsigned int const);
+  extern template FullMatrix<float>
+  get_time_prolongation_matrix<float>(TimeStepType,
+                                      unsigned int const,
+                                      unsigned int const);
+  extern template FullMatrix<double>
+  get_time_restriction_matrix<double>(TimeStepType,
+                                      unsigned int const,
+                                      unsigned int const);
+  extern template FullMatrix<float>
+  get_time_restriction_matrix<float>(TimeStepType,
+                                     unsigned int const,
+                                     unsigned int const);
+#endif
 } // namespace dealii
@@ -2,11 +2,14 @@
 // Copyright (C) 2024 by Nils Margenberg and Peter Munch
 
 #pragma once
+#include <deal.II/base/conditional_ostream.h>
 #include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/table_handler.h>
 
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/dofs/dof_tools.h>
 
+#include <deal.II/lac/lapack_full_matrix.h>
 #include <deal.II/lac/solver_control.h>
 #include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/sparse_matrix_tools.h>
@@ -18,9 +21,18 @@
 #include <deal.II/multigrid/mg_transfer_global_coarsening.templates.h>
 #include <deal.II/multigrid/multigrid.h>
 
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+#include <chrono>
+#include <set>
 #include <variant>
 
+#include "communication.h"
 #include "fe_time.h"
+#include "markers.h"
+#include "trace.h"
 #include "types.h"
 
 
@@ -213,6 +225,8 @@ namespace dealii
                        BlockVectorType       &dst,
                        const BlockVectorType &src) const override final
     {
+      CommunicationScope scope(CommunicationKernel::transfer);
+      RegionMarker       marker("prolongate");
       transfer[to_level].prolongate_and_add(dst, src);
     }
 
@@ -221,6 +235,8 @@ namespace dealii
                      BlockVectorType       &dst,
                      const BlockVectorType &src) const override final
     {
+      CommunicationScope scope(CommunicationKernel::transfer);
+      RegionMarker       marker("restrict");
       transfer[from_level].restrict_and_add(dst, src);
     }
 
@@ -399,6 +415,102 @@ namespace dealii
       space_transfers, transfer, n_blocks, partitioners);
   }
 
+  /** Spatial part of the Vanka patches: the DoF indices and valences of the
+   * cell patches and the local stiffness and mass matrices. It only depends on
+   * the spatial discretization, so multigrid levels that differ only in time
+   * can share one instance and rebuild just the space-time inverses.
+   */
+  template <typename Number>
+  class VankaPatchData
+  {
+  public:
+    /** One patch per locally owned cell. The patches are processed in the
+     * order of cell_order if given, e.g. the cell batch order of MatrixFree,
+     * and in the order of the active cells otherwise.
+     */
+    template <int dim>
+    VankaPatchData(
+      std::shared_ptr<const SparseMatrixType> const             &K_,
+      std::shared_ptr<const SparseMatrixType> const             &M_,
+      std::shared_ptr<const SparsityPatternType> const          &SP_,
+      std::shared_ptr<const DoFHandler<dim>> const              &dof_handler,
+      std::vector<typename DoFHandler<dim>::cell_iterator> const &cell_order =
+        {});
+
+    /** Replace the stiffness cell matrices after the coefficient changed.
+     * The mass cell matrices have to be kept for this.
+     */
+    void
+    update_stiffness(SparseMatrixType const &K_, SparsityPatternType const &SP_)
+    {
+      SparseMatrixTools::restrict_to_full_matrices(K_, SP_, indices, K_blocks);
+    }
+
+    /** The cell matrices are only needed to set up the smoothers. Release
+     * them once all levels sharing this object are initialized.
+     */
+    void
+    clear_cell_matrices()
+    {
+      std::vector<FullMatrix<Number>>().swap(K_blocks);
+      std::vector<FullMatrix<Number>>().swap(M_blocks);
+    }
+
+    std::vector<std::vector<types::global_dof_index>> indices;
+    VectorT<Number>                                   valence;
+    std::vector<FullMatrix<Number>>                   K_blocks;
+    std::vector<FullMatrix<Number>>                   M_blocks;
+  };
+
+  template <typename Number>
+  template <int dim>
+  VankaPatchData<Number>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const              &K_,
+    std::shared_ptr<const SparseMatrixType> const              &M_,
+    std::shared_ptr<const SparsityPatternType> const           &SP_,
+    std::shared_ptr<const DoFHandler<dim>> const               &dof_handler,
+    std::vector<typename DoFHandler<dim>::cell_iterator> const &cell_order)
+  {
+    IndexSet locally_relevant_dofs;
+    DoFTools::extract_locally_relevant_dofs(*dof_handler,
+                                            locally_relevant_dofs);
+
+    valence.reinit(dof_handler->locally_owned_dofs(),
+                   locally_relevant_dofs,
+                   dof_handler->get_communicator());
+
+    auto const add_patch = [&](auto const &cell) {
+      std::vector<types::global_dof_index> my_indices(
+        cell->get_fe().n_dofs_per_cell());
+      cell->get_dof_indices(my_indices);
+      for (auto const &dof_index : my_indices)
+        valence(dof_index) += static_cast<Number>(1);
+
+      indices.emplace_back(my_indices);
+    };
+    if (cell_order.empty())
+      {
+        for (const auto &cell : dof_handler->active_cell_iterators())
+          if (cell->is_locally_owned())
+            add_patch(cell);
+      }
+    else
+      for (const auto &cell : cell_order)
+        add_patch(cell);
+    valence.compress(VectorOperation::add);
+
+    SparseMatrixTools::restrict_to_full_matrices(*K_,
+                                                 *SP_,
+                                                 indices,
+                                                 K_blocks);
+    SparseMatrixTools::restrict_to_full_matrices(*M_,
+                                                 *SP_,
+                                                 indices,
+                                                 M_blocks);
+
+    valence.update_ghost_values();
+  }
+
   template <typename Number>
   class PreconditionVanka
   {
@@ -413,91 +525,202 @@ namespace dealii
                       std::shared_ptr<const SparsityPatternType> const &SP_,
                       const FullMatrix<Number>                         &Alpha,
                       const FullMatrix<Number>                         &Beta,
-                      std::shared_ptr<const DoFHandler<dim>> const &dof_handler)
+                      std::shared_ptr<const DoFHandler<dim>> const
+                        &dof_handler);
+
+    /** With lu_solve, the LU factorizations of the patch matrices are kept
+     * and applied by triangular solves instead of explicit inverses. This
+     * requires LAPACK.
+     */
+    PreconditionVanka(
+      TimerOutput                                         &timer,
+      std::shared_ptr<const VankaPatchData<Number>> const &patches_,
+      const FullMatrix<Number>                            &Alpha,
+      const FullMatrix<Number>                            &Beta,
+      bool const                                           lu_solve = false)
       : timer(timer)
+      , lu_solve(lu_solve)
+      , patches(patches_)
     {
-      std::vector<FullMatrix<Number>> K_blocks, M_blocks;
-      IndexSet                        locally_relevant_dofs;
-      DoFTools::extract_locally_relevant_dofs(*dof_handler,
-                                              locally_relevant_dofs);
+      setup_blocks(Alpha, Beta);
+    }
 
-      valence.reinit(dof_handler->locally_owned_dofs(),
-                     locally_relevant_dofs,
-                     dof_handler->get_communicator());
+    /** Empty preconditioner for a level that is never smoothed by Vanka.
+     * No patches or inverses are set up, and reinit() does nothing.
+     */
+    explicit PreconditionVanka(TimerOutput &timer)
+      : timer(timer)
+    {}
 
-      for (const auto &cell : dof_handler->active_cell_iterators())
-        {
-          if (cell->is_locally_owned())
-            {
-              std::vector<types::global_dof_index> my_indices(
-                cell->get_fe().n_dofs_per_cell());
-              cell->get_dof_indices(my_indices);
-              for (auto const &dof_index : my_indices)
-                valence(dof_index) += static_cast<Number>(1);
+    /** Copy of other that shares the patches and the inverses and records
+     * its timings in timer instead. A later reinit() of either does not
+     * affect the other. Both use the communicator of the patch data, see
+     * GMG::clone().
+     */
+    PreconditionVanka(TimerOutput &timer, PreconditionVanka const &other)
+      : timer(timer)
+      , damp(other.damp)
+      , float_inverses(other.float_inverses)
+      , lu_solve(other.lu_solve)
+      , patches(other.patches)
+      , blocks(other.blocks)
+      , blocks_float(other.blocks_float)
+      , blocks_lu(other.blocks_lu)
+    {}
 
-              indices.emplace_back(my_indices);
-            }
-        }
-      valence.compress(VectorOperation::add);
+    void
+    vmult(BlockVectorType &dst, const BlockVectorType &src) const;
 
+    /** Recompute the space-time inverses for new time weights. The patch
+     * data must still hold the cell matrices. After clear(), this does
+     * nothing.
+     */
+    void
+    reinit(const FullMatrix<Number> &Alpha, const FullMatrix<Number> &Beta)
+    {
+      if (patches)
+        setup_blocks(Alpha, Beta);
+    }
 
-      SparseMatrixTools::restrict_to_full_matrices(*K_,
-                                                   *SP_,
-                                                   indices,
-                                                   K_blocks);
-      SparseMatrixTools::restrict_to_full_matrices(*M_,
-                                                   *SP_,
-                                                   indices,
-                                                   M_blocks);
+    bool
+    empty() const
+    {
+      return !patches;
+    }
 
-      blocks.resize(K_blocks.size());
-      for (unsigned int ii = 0; ii < blocks.size(); ++ii)
+    /** Store the inverses in float, rounded from the inverses computed in
+     * Number, and apply them to vectors in Number. This halves the memory
+     * and the bandwidth of the inverses for Number = double and has no
+     * effect for Number = float or with LU solves. The setting is kept by
+     * reinit().
+     */
+    void
+    set_float_inverses(bool const float_inverses_)
+    {
+      float_inverses =
+        float_inverses_ && !std::is_same_v<Number, float> && !lu_solve;
+      if (float_inverses && blocks)
         {
-          const auto &K = K_blocks[ii];
-          const auto &M = M_blocks[ii];
-          auto       &B = blocks[ii];
+          auto blocks_float_ =
+            std::make_shared<std::vector<FullMatrix<float>>>(blocks->size());
+          for (unsigned int i = 0; i < blocks->size(); ++i)
+            (*blocks_float_)[i].copy_from((*blocks)[i]);
+          blocks_float = blocks_float_;
+          blocks.reset();
+        }
+      else if (!float_inverses && blocks_float)
+        {
+          auto blocks_ = std::make_shared<std::vector<FullMatrix<Number>>>(
+            blocks_float->size());
+          for (unsigned int i = 0; i < blocks_float->size(); ++i)
+            (*blocks_)[i].copy_from((*blocks_float)[i]);
+          blocks = blocks_;
+          blocks_float.reset();
+        }
+    }
 
-          B = FullMatrix<Number>(K.m() * Alpha.m(), K.n() * Alpha.n());
+    void
+    clear()
+    {
+      patches.reset();
+      blocks.reset();
+      blocks_float.reset();
+      blocks_lu.reset();
+    }
 
-          for (unsigned int i = 0; i < Alpha.m(); ++i)
-            for (unsigned int j = 0; j < Alpha.n(); ++j)
-              if (Beta(i, j) != 0.0 || Alpha(i, j) != 0.0)
-                for (unsigned int k = 0; k < K.m(); ++k)
-                  for (unsigned int l = 0; l < K.n(); ++l)
-                    B(k + i * K.m(), l + j * K.n()) =
-                      Beta(i, j) * M(k, l) + Alpha(i, j) * K(k, l);
+    void
+    smooth(BlockVectorType &u, BlockVectorType const &rhs) const
+    {
+      vmult(u, rhs);
+    }
 
-          B.gauss_jordan();
-        }
 
-      valence.update_ghost_values();
-    }
 
+  private:
     void
-    vmult(BlockVectorType &dst, const BlockVectorType &src) const
+    setup_blocks(const FullMatrix<Number> &Alpha,
+                 const FullMatrix<Number> &Beta);
+
+    // Explicit inverse from the blocked LU factorization of LAPACK (getrf
+    // and getri), and by Gauss-Jordan elimination without LAPACK
+    static void
+    invert(FullMatrix<Number> &B)
     {
-      TimerOutput::Scope scope(timer, "vanka");
+#ifdef DEAL_II_WITH_LAPACK
+      LAPACKFullMatrix<Number> lu(B.m());
+      lu = B;
+      lu.invert();
+      B = lu;
+#else
+      B.gauss_jordan();
+#endif
+    }
 
-      dst = 0.0;
+    TimerOutput &timer;
 
-      Vector<Number>     dst_local;
-      Vector<Number>     src_local;
-      const unsigned int n_blocks = src.n_blocks();
-      for (unsigned int i = 0; i < n_blocks; ++i)
-        src.block(i).update_ghost_values();
+    Number damp           = 1.0;
+    bool   float_inverses = false;
+    bool   lu_solve       = false;
 
-      for (unsigned int i = 0; i < blocks.size(); ++i)
+    std::shared_ptr<const VankaPatchData<Number>>          patches;
+    std::shared_ptr<const std::vector<FullMatrix<Number>>> blocks;
+    // Inverses in float, blocks is empty if they are set
+    std::shared_ptr<const std::vector<FullMatrix<float>>> blocks_float;
+    // LU factorizations, used instead of blocks with lu_solve
+    std::shared_ptr<const std::vector<LAPACKFullMatrix<Number>>> blocks_lu;
+  };
+
+  template <typename Number>
+  template <int dim>
+  PreconditionVanka<Number>::PreconditionVanka(
+    TimerOutput                                      &timer,
+    std::shared_ptr<const SparseMatrixType> const    &K_,
+    std::shared_ptr<const SparseMatrixType> const    &M_,
+    std::shared_ptr<const SparsityPatternType> const &SP_,
+    const FullMatrix<Number>                         &Alpha,
+    const FullMatrix<Number>                         &Beta,
+    std::shared_ptr<const DoFHandler<dim>> const     &dof_handler)
+    : timer(timer)
+  {
+    auto patches_ =
+      std::make_shared<VankaPatchData<Number>>(K_, M_, SP_, dof_handler);
+    patches = patches_;
+    setup_blocks(Alpha, Beta);
+    patches_->clear_cell_matrices();
+  }
+
+  template <typename Number>
+  void
+  PreconditionVanka<Number>::vmult(BlockVectorType       &dst,
+                                   const BlockVectorType &src) const
+  {
+    TimerOutput::Scope scope(timer, "vanka");
+    CommunicationScope comm_scope(CommunicationKernel::vanka);
+
+    dst = 0.0;
+
+    auto const        &indices = patches->indices;
+    auto const        &valence = patches->valence;
+    const unsigned int n_blocks = src.n_blocks();
+    for (unsigned int i = 0; i < n_blocks; ++i)
+      src.block(i).update_ghost_values();
+
+    RegionMarker marker("vanka_patches");
+    auto const apply_patches = [&](auto const &patch_solve) {
+      Vector<Number> dst_local;
+      Vector<Number> src_local;
+      for (unsigned int i = 0; i < indices.size(); ++i)
         {
           // gather
-          src_local.reinit(blocks[i].m());
-          dst_local.reinit(blocks[i].m());
+          src_local.reinit(n_blocks * indices[i].size());
+          dst_local.reinit(n_blocks * indices[i].size());
 
           for (unsigned int b = 0, c = 0; b < n_blocks; ++b)
             for (unsigned int j = 0; j < indices[i].size(); ++j, ++c)
               src_local[c] = src.block(b)[indices[i][j]];
 
           // patch solver
-          blocks[i].vmult(dst_local, src_local);
+          patch_solve(i, dst_local, src_local);
 
           // scatter
           for (unsigned int b = 0, c = 0; b < n_blocks; ++b)
@@ -507,36 +730,177 @@ namespace dealii
                 dst.block(b)[indices[i][j]] += weight * dst_local[c];
               }
         }
+    };
+    if (blocks_lu)
+      apply_patches([&](unsigned int const    i,
+                        Vector<Number>       &dst_local,
+                        Vector<Number> const &src_local) {
+        dst_local = src_local;
+        (*blocks_lu)[i].solve(dst_local);
+      });
+    else if (blocks_float)
+      apply_patches([&](unsigned int const    i,
+                        Vector<Number>       &dst_local,
+                        Vector<Number> const &src_local) {
+        // Each entry is read in float and converted in the product loop,
+        // the sums are accumulated in Number. Four partial sums per row
+        // break the dependency chain of the additions, with a single sum
+        // the loop is bound by the add latency rather than the reads.
+        FullMatrix<float> const &block = (*blocks_float)[i];
+        float const             *entry = block.empty() ? nullptr : &block(0, 0);
+        unsigned int const       n     = block.n();
+        for (unsigned int r = 0; r < block.m(); ++r)
+          {
+            Number       sum[4] = {};
+            unsigned int c      = 0;
+            for (; c + 4 <= n; c += 4, entry += 4)
+              for (unsigned int k = 0; k < 4; ++k)
+                sum[k] += static_cast<Number>(entry[k]) * src_local[c + k];
+            for (; c < n; ++c, ++entry)
+              sum[0] += static_cast<Number>(*entry) * src_local[c];
+            dst_local[r] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+          }
+      });
+    else
+      apply_patches([&](unsigned int const    i,
+                        Vector<Number>       &dst_local,
+                        Vector<Number> const &src_local) {
+        (*blocks)[i].vmult(dst_local, src_local);
+      });
+
+    for (unsigned int i = 0; i < n_blocks; ++i)
+      src.block(i).zero_out_ghost_values();
+    dst.compress(VectorOperation::add);
+  }
+
+  template <typename Number>
+  void
+  PreconditionVanka<Number>::setup_blocks(const FullMatrix<Number> &Alpha,
+                                          const FullMatrix<Number> &Beta)
+  {
+    TimerOutput::Scope scope(timer, "vanka_setup");
+    AssertDimension(patches->K_blocks.size(), patches->indices.size());
+    unsigned int const n_patches = patches->K_blocks.size();
+    // new inverses, copies made by the constructor keep the old ones
+    auto blocks = std::make_shared<std::vector<FullMatrix<Number>>>(
+      lu_solve ? 0 : n_patches);
+    auto blocks_lu = std::make_shared<std::vector<LAPACKFullMatrix<Number>>>(
+      lu_solve ? n_patches : 0);
+    FullMatrix<Number> B;
+    for (unsigned int ii = 0; ii < n_patches; ++ii)
+      {
+        const auto &K = patches->K_blocks[ii];
+        const auto &M = patches->M_blocks[ii];
+
+        B.reinit(K.m() * Alpha.m(), K.n() * Alpha.n());
+
+        for (unsigned int i = 0; i < Alpha.m(); ++i)
+          for (unsigned int j = 0; j < Alpha.n(); ++j)
+            if (Beta(i, j) != 0.0 || Alpha(i, j) != 0.0)
+              for (unsigned int k = 0; k < K.m(); ++k)
+                for (unsigned int l = 0; l < K.n(); ++l)
+                  B(k + i * K.m(), l + j * K.n()) =
+                    Beta(i, j) * M(k, l) + Alpha(i, j) * K(k, l);
+
+        if (lu_solve)
+          {
+            auto &lu = (*blocks_lu)[ii];
+            lu.reinit(B.m());
+            lu = B;
+            lu.compute_lu_factorization();
+          }
+        else
+          {
+            invert(B);
+            (*blocks)[ii] = B;
+          }
+      }
+    this->blocks       = lu_solve ? nullptr : blocks;
+    this->blocks_lu    = lu_solve ? blocks_lu : nullptr;
+    this->blocks_float = nullptr;
+    if (float_inverses)
+      set_float_inverses(true);
+  }
+
+  /** Smoother of one level, either a relaxation with the Vanka
+   * preconditioner or a Chebyshev iteration with point Jacobi. The latter
+   * only needs the diagonal of the level operator instead of the Vanka
+   * inverses.
+   */
+  template <typename MatrixType, typename VectorType, typename VankaType>
+  class PreconditionHybrid
+  {
+  public:
+    using RelaxationType = PreconditionRelaxation<MatrixType, VankaType>;
+    using ChebyshevType =
+      PreconditionChebyshev<MatrixType, VectorType, DiagonalMatrix<VectorType>>;
+
+    struct AdditionalData
+    {
+      bool                                    use_chebyshev = false;
+      typename RelaxationType::AdditionalData relaxation;
+      typename ChebyshevType::AdditionalData  chebyshev;
+    };
 
-      for (unsigned int i = 0; i < n_blocks; ++i)
-        src.block(i).zero_out_ghost_values();
-      dst.compress(VectorOperation::add);
+    void
+    initialize(MatrixType const &matrix, AdditionalData const &data)
+    {
+      use_chebyshev = data.use_chebyshev;
+      relaxation.clear();
+      chebyshev.clear();
+      if (use_chebyshev)
+        chebyshev.initialize(matrix, data.chebyshev);
+      else
+        relaxation.initialize(matrix, data.relaxation);
     }
 
     void
     clear()
     {
-      indices.clear();
-      valence.reinit(0);
-      blocks.clear();
+      relaxation.clear();
+      chebyshev.clear();
     }
 
     void
-    smooth(BlockVectorType &u, BlockVectorType const &rhs) const
+    vmult(VectorType &dst, VectorType const &src) const
     {
-      vmult(u, rhs);
+      if (use_chebyshev)
+        chebyshev.vmult(dst, src);
+      else
+        relaxation.vmult(dst, src);
     }
 
+    void
+    Tvmult(VectorType &dst, VectorType const &src) const
+    {
+      if (use_chebyshev)
+        chebyshev.Tvmult(dst, src);
+      else
+        relaxation.Tvmult(dst, src);
+    }
 
+    void
+    step(VectorType &dst, VectorType const &src) const
+    {
+      if (use_chebyshev)
+        chebyshev.step(dst, src);
+      else
+        relaxation.step(dst, src);
+    }
 
-  private:
-    TimerOutput &timer;
-
-    Number damp = 1.0;
+    void
+    Tstep(VectorType &dst, VectorType const &src) const
+    {
+      if (use_chebyshev)
+        chebyshev.Tstep(dst, src);
+      else
+        relaxation.Tstep(dst, src);
+    }
 
-    std::vector<std::vector<types::global_dof_index>> indices;
-    VectorType                                        valence;
-    std::vector<FullMatrix<Number>>                   blocks;
+  private:
+    bool           use_chebyshev = false;
+    RelaxationType relaxation;
+    ChebyshevType  chebyshev;
   };
 
   struct PreconditionerGMGAdditionalData
@@ -548,6 +912,25 @@ namespace dealii
 
     bool estimate_relaxation = true;
 
+    // Smoothing steps and damping of the relaxation parameter per level,
+    // counted from the coarsest level. Levels without an entry use
+    // smoothing_steps and no damping.
+    std::vector<unsigned int> level_smoothing_steps;
+    std::vector<double>       level_damping;
+
+    // Smoother per level, counted from the coarsest level: "vanka" or
+    // "chebyshev" for a Chebyshev iteration with point Jacobi of degree
+    // smoothing_degree per smoothing step. Levels without an entry use
+    // Vanka, the damping does not apply to Chebyshev.
+    std::vector<std::string> level_smoother;
+    double                   chebyshev_smoothing_range = 20.0;
+
+    // Store the Vanka inverses in float if the preconditioner runs in double
+    bool float_vanka_inverses = false;
+    // Apply LU factorizations of the Vanka patch matrices instead of
+    // explicit inverses
+    bool vanka_lu_solve = false;
+
     std::string coarse_grid_smoother_type = "Smoother";
 
     unsigned int coarse_grid_maxiter = 10;
@@ -557,6 +940,39 @@ namespace dealii
     bool restrict_is_transpose_prolongate = true;
     bool variable                         = true;
   };
+
+  struct NewtonAdditionalData
+  {
+    unsigned int max_iterations = 20;
+    double       abstol         = 1e-12;
+    double       reltol         = 1e-8;
+    double       linear_reltol  = 1e-4;
+
+    // Rebuild the lagged preconditioner once a linear solve needs this many
+    // times the iterations of the first solve after the last rebuild
+    double rebuild_factor = 2.0;
+  };
+  struct SlabSolverAdditionalData
+  {
+    SlabSolverType type = SlabSolverType::fgmres;
+
+    // Richardson falls back to FGMRES once an iteration reduces the residual
+    // by less than this factor
+    double stall_rate = 0.9;
+
+    // Dimension of the shadow space of IDR(s)
+    unsigned int idr_s = 2;
+
+    // Store the FGMRES Krylov basis in float
+    bool float_basis = false;
+
+    // Relative tolerance of the inner solves of the iterative refinement
+    double inner_reltol = 1e-3;
+
+    // Start each linear slab solve from a full multigrid cycle instead of
+    // the extrapolated initial guess
+    bool fmg_start = false;
+  };
   template <int dim>
   struct Parameters
   {
@@ -587,11 +1003,87 @@ namespace dealii
     Point<dim> source = .5 * hyperrect_lower_left + .5 * hyperrect_upper_right;
     double     end_time = 1.0;
 
+    // Constant velocity of the material distribution. A non-zero value makes
+    // the coefficient time-dependent; it is frozen at the midpoint of each
+    // slab. The smoothers are only rebuilt once the accumulated relative
+    // change of the coefficient exceeds smoother_update_threshold.
+    Point<dim> coefficient_velocity      = Point<dim>();
+    double     smoother_update_threshold = 0.1;
+
+    // Use the solution of the previous refinement cycle as initial guess
+    bool nested_iteration = false;
+    // Renumber the DoFs on all levels for data locality in MatrixFree
+    bool renumber_dofs = false;
+
+    // Store geometry and coefficients of the outer operators in float
+    bool float_geometry = false;
+    // Apply the preconditioner in double instead of float. Needed for
+    // floatVankaInverses to take effect.
+    bool precondition_double = false;
+    // Only store the mapping data needed by the matrix-free operators
+    bool lean_setup = false;
+
+    // Integrator for the wave problem: implicit space-time slabs, explicit
+    // leapfrog or whichever is estimated cheaper. The estimate assumes
+    // leapfrog_iterations_estimate FGMRES iterations per space-time slab.
+    WaveIntegratorType wave_integrator = WaveIntegratorType::space_time;
+    double             leapfrog_cfl    = 0.9;
+    double             leapfrog_iterations_estimate = 10.0;
+
+    // Cubic reaction sigma u^3 added to the heat or wave equation. A non-zero
+    // value switches to the Newton-Krylov slab solver.
+    double reaction_coefficient = 0.0;
+
+    NewtonAdditionalData     newton_data;
+    SlabSolverAdditionalData slab_solver_data;
+
     PreconditionerGMGAdditionalData mg_data;
+
+    // Tune smoother, smoothing steps and damping per level on the first
+    // slab and optionally write the result to a copy of the parameter file
+    bool                      tune_smoothers       = false;
+    std::vector<unsigned int> tune_smoothing_steps = {1, 2, 3};
+    std::vector<double>       tune_damping         = {0.8, 1.0, 1.2};
+    std::vector<std::string>  tune_smoother_types  = {"vanka"};
+    std::string               tuned_smoothers_file = "";
+
+    // Print the distribution of the multigrid levels over the ranks and flag
+    // levels with a max/avg ratio of cells or DoFs above the threshold
+    bool   print_mg_hierarchy     = false;
+    double mg_imbalance_threshold = 1.2;
+
+    // Apply a clone of the preconditioner and compare with the original
+    bool check_clone = false;
+
+    // Write a timeline of slabs, V-cycles and MPI waits in the Chrome trace
+    // format to trace_file, merged over the ranks or one file per rank. Each
+    // run overwrites the file of the previous one.
+    std::string trace_file  = "";
+    bool        trace_merge = true;
+
+    // Before the runs, solve tune_slabs slabs for each power of two up to
+    // tune_timesteps_at_once_max time steps per slab and continue with the
+    // fastest one per unit of simulated time
+    bool         tune_timesteps_at_once     = false;
+    unsigned int tune_timesteps_at_once_max = 8;
+    unsigned int tune_slabs                 = 2;
+
+    // Choose the time degree of each slab between adaptive_time_degree_min
+    // and fe_degree from the relative size of the highest Legendre
+    // coefficient of the previous slab: raise it above the refine tolerance,
+    // lower it below the coarsen tolerance. The indicator is predictive only:
+    // a slab is never re-solved, also not if its own indicator exceeds the
+    // refine tolerance, it only sets the degree of the next slab
+    bool         adaptive_time_degree     = false;
+    unsigned int adaptive_time_degree_min = 1;
+    double       time_degree_refine_tol   = 1.e-2;
+    double       time_degree_coarsen_tol  = 1.e-4;
+
     void
     parse(const std::string file_name)
     {
-      std::string              type_, problem_;
+      std::string              type_, problem_, wave_integrator_ = "spaceTime";
+      std::string              slab_solver_ = "FGMRES";
       dealii::ParameterHandler prm;
       prm.add_parameter("doOutput", do_output);
       prm.add_parameter("printTiming", print_timing);
@@ -617,6 +1109,18 @@ namespace dealii
       prm.add_parameter("distortCoeff", distort_coeff);
       prm.add_parameter("sourcePoint", source);
       prm.add_parameter("endTime", end_time);
+      prm.add_parameter("coefficientVelocity", coefficient_velocity);
+      prm.add_parameter("smootherUpdateThreshold", smoother_update_threshold);
+      prm.add_parameter("nestedIteration", nested_iteration);
+      prm.add_parameter("renumberDofs", renumber_dofs);
+      prm.add_parameter("floatGeometry", float_geometry);
+      prm.add_parameter("preconditionDouble", precondition_double);
+      prm.add_parameter("leanSetup", lean_setup);
+      prm.add_parameter("waveIntegrator", wave_integrator_);
+      prm.add_parameter("leapfrogCfl", leapfrog_cfl);
+      prm.add_parameter("leapfrogIterationsEstimate",
+                        leapfrog_iterations_estimate);
+      prm.add_parameter("reactionCoefficient", reaction_coefficient);
 
       prm.add_parameter("smoothingDegree", mg_data.smoothing_degree);
       prm.add_parameter("smoothingSteps", mg_data.smoothing_steps);
@@ -629,11 +1133,48 @@ namespace dealii
       prm.add_parameter("restrictIsTransposeProlongate",
                         mg_data.restrict_is_transpose_prolongate);
       prm.add_parameter("variable", mg_data.variable);
+      prm.add_parameter("levelSmoothingSteps", mg_data.level_smoothing_steps);
+      prm.add_parameter("levelDamping", mg_data.level_damping);
+      prm.add_parameter("levelSmoother", mg_data.level_smoother);
+      prm.add_parameter("chebyshevSmoothingRange",
+                        mg_data.chebyshev_smoothing_range);
+      prm.add_parameter("floatVankaInverses", mg_data.float_vanka_inverses);
+      prm.add_parameter("vankaLuSolve", mg_data.vanka_lu_solve);
+      prm.add_parameter("tuneSmoothers", tune_smoothers);
+      prm.add_parameter("tuneSmoothingSteps", tune_smoothing_steps);
+      prm.add_parameter("tuneDamping", tune_damping);
+      prm.add_parameter("tuneSmootherTypes", tune_smoother_types);
+      prm.add_parameter("tunedSmoothersFile", tuned_smoothers_file);
+      prm.add_parameter("printMgHierarchy", print_mg_hierarchy);
+      prm.add_parameter("checkClone", check_clone);
+      prm.add_parameter("mgImbalanceThreshold", mg_imbalance_threshold);
+      prm.add_parameter("traceFile", trace_file);
+      prm.add_parameter("traceMerge", trace_merge);
+      prm.add_parameter("tuneTimestepsAtOnce", tune_timesteps_at_once);
+      prm.add_parameter("tuneTimestepsAtOnceMax", tune_timesteps_at_once_max);
+      prm.add_parameter("tuneSlabs", tune_slabs);
+      prm.add_parameter("adaptiveTimeDegree", adaptive_time_degree);
+      prm.add_parameter("adaptiveTimeDegreeMin", adaptive_time_degree_min);
+      prm.add_parameter("timeDegreeRefineTol", time_degree_refine_tol);
+      prm.add_parameter("timeDegreeCoarsenTol", time_degree_coarsen_tol);
+      prm.add_parameter("newtonMaxIterations", newton_data.max_iterations);
+      prm.add_parameter("newtonAbstol", newton_data.abstol);
+      prm.add_parameter("newtonReltol", newton_data.reltol);
+      prm.add_parameter("newtonLinearReltol", newton_data.linear_reltol);
+      prm.add_parameter("newtonRebuildFactor", newton_data.rebuild_factor);
+      prm.add_parameter("slabSolver", slab_solver_);
+      prm.add_parameter("richardsonStallRate", slab_solver_data.stall_rate);
+      prm.add_parameter("idrS", slab_solver_data.idr_s);
+      prm.add_parameter("floatKrylovBasis", slab_solver_data.float_basis);
+      prm.add_parameter("refinementInnerReltol", slab_solver_data.inner_reltol);
+      prm.add_parameter("fullMultigridStart", slab_solver_data.fmg_start);
       std::ifstream file;
       file.open(file_name);
       prm.parse_input_from_json(file, true);
       type    = str_to_time_type.at(type_);
       problem = str_to_problem_type.at(problem_);
+      wave_integrator = str_to_wave_integrator_type.at(wave_integrator_);
+      slab_solver_data.type = str_to_slab_solver_type.at(slab_solver_);
       if (n_timesteps_at_once_min == -1)
         n_timesteps_at_once_min = n_timesteps_at_once / 2;
 
@@ -646,6 +1187,27 @@ namespace dealii
         fe_degree_min = fe_degree - 1;
       fe_degree_min =
         std::clamp(fe_degree_min, lowest_degree, static_cast<int>(fe_degree));
+      // The indicator compares the highest with the lower coefficients
+      adaptive_time_degree_min = std::max(adaptive_time_degree_min, 1u);
+    }
+
+    /** Write the parameter file file_name to output_file_name with the
+     * per-level smoother settings replaced by the ones in data. Passing the
+     * same name for both overwrites the parameter file.
+     */
+    static void
+    write_smoother_settings(std::string const &file_name,
+                            std::string const &output_file_name,
+                            PreconditionerGMGAdditionalData const &data)
+    {
+      boost::property_tree::ptree tree;
+      boost::property_tree::read_json(file_name, tree);
+      tree.put("levelSmoothingSteps",
+               Patterns::Tools::to_string(data.level_smoothing_steps));
+      tree.put("levelDamping", Patterns::Tools::to_string(data.level_damping));
+      tree.put("levelSmoother",
+               Patterns::Tools::to_string(data.level_smoother));
+      boost::property_tree::write_json(output_file_name, tree);
     }
   };
 
@@ -658,12 +1220,15 @@ namespace dealii
     using MGTransferType = STMGTransferBlockMatrixFree<dim, Number>;
 
     using SmootherPreconditionerType = PreconditionVanka<Number>;
-    using SmootherType =
-      PreconditionRelaxation<LevelMatrixType, SmootherPreconditionerType>;
+    using SmootherType               = PreconditionHybrid<LevelMatrixType,
+                                            BlockVectorType,
+                                            SmootherPreconditionerType>;
     using MGSmootherType =
       MGSmootherPrecondition<LevelMatrixType, SmootherType, BlockVectorType>;
 
   public:
+    using value_type = Number;
+
     GMG(
       TimerOutput                   &timer,
       Parameters<dim> const         &parameters,
@@ -679,193 +1244,374 @@ namespace dealii
       const MGLevelObject<std::shared_ptr<SmootherPreconditionerType>>
                                         &mg_smoother_,
       std::unique_ptr<BlockVectorType> &&tmp1,
-      std::unique_ptr<BlockVectorType> &&tmp2)
-      : timer(timer)
-      , additional_data(parameters.mg_data)
-      , src_(std::move(tmp1))
-      , dst_(std::move(tmp2))
-      , dof_handler(dof_handler)
-      , mg_dof_handlers(mg_dof_handlers)
-      , mg_constraints(mg_constraints)
-      , mg_operators(mg_operators)
-      , precondition_vanka(mg_smoother_)
-      , min_level(mg_dof_handlers.min_level())
-      , max_level(mg_dof_handlers.max_level())
-    {
-      transfer_block = build_stmg_transfers<dim, Number>(
-        parameters.type,
-        r,
-        n_timesteps_at_once,
-        mg_dof_handlers,
-        mg_constraints,
-        [&](const unsigned int l, VectorType &vec) {
-          this->mg_operators[l]->initialize_dof_vector(vec);
-        },
-        additional_data.restrict_is_transpose_prolongate,
-        mg_type_level);
-    }
-
-    void
-    reinit() const
-    {
-      // wrap level operators
-      mg_matrix = mg::Matrix<BlockVectorType>(mg_operators);
-
-      MGLevelObject<typename SmootherType::AdditionalData> smoother_data(
-        min_level, max_level);
-
-      // setup smoothers on each level
-      for (unsigned int level = min_level; level <= max_level; ++level)
+      std::unique_ptr<BlockVectorType> &&tmp2);
+
+    void
+    reinit() const;
+
+    double
+    estimate_relaxation(unsigned level) const;
+
+    template <typename SolutionVectorType = BlockVectorType>
+    void
+    vmult(SolutionVectorType &dst, const SolutionVectorType &src) const;
+
+    /** Full multigrid start for the slab. The right-hand side is restricted
+     * to all levels and solved on the coarsest level. The result is
+     * prolongated and improved by one V-cycle on each finer level, so the
+     * finest level starts with an error at the level of the discretization
+     * error. This needs an accurate coarse solution. The default coarse
+     * grid solver is one smoother application, so the coarse problem is
+     * solved here by GMRES, preconditioned by the coarse smoother, to a
+     * relative tolerance of 1e-8 within at most 100 iterations.
+     */
+    template <typename SolutionVectorType = BlockVectorType>
+    void
+    fmg(SolutionVectorType &dst, const SolutionVectorType &src) const
+    {
+      TimerOutput::Scope scope(timer, "fmg");
+      TraceScope         trace("fmg", "mg");
+
+      MGLevelObject<BlockVectorType> x(min_level, max_level),
+        b(min_level, max_level), t(min_level, max_level),
+        d(min_level, max_level), c(min_level, max_level);
+      transfer_block->copy_to_mg(dof_handler, b, src);
+      for (unsigned int l = min_level; l <= max_level; ++l)
+        for (auto *vec : {&x[l], &t[l], &d[l], &c[l]})
+          mg_operators[l]->initialize_dof_vector(*vec);
+      for (unsigned int l = max_level; l > min_level; --l)
+        transfer_block->restrict_and_add(l, b[l - 1], b[l]);
+
+      {
+        ReductionControl control(
+          100, additional_data.coarse_grid_abstol, 1e-8, false, false);
+
+        SolverGMRES<BlockVectorType> gmres(control);
+        try
+          {
+            gmres.solve(*mg_operators[min_level],
+                        x[min_level],
+                        b[min_level],
+                        mg_smoother->smoothers[min_level]);
+          }
+        catch (const SolverControl::NoConvergence &)
+          {
+            // keep the last iterate, the V-cycles reduce the error further
+          }
+      }
+      for (unsigned int l = min_level + 1; l <= max_level; ++l)
         {
-          smoother_data[level].preconditioner = precondition_vanka[level];
-          smoother_data[level].n_iterations   = additional_data.smoothing_steps;
-          smoother_data[level].relaxation =
-            additional_data.estimate_relaxation ? estimate_relaxation(level) :
-                                                  1.0;
+          transfer_block->prolongate(l, x[l], x[l - 1]);
+          vcycle(l, x[l], b[l], t, d, c);
         }
-      mg_smoother = std::make_unique<MGSmootherType>(1,
-                                                     additional_data.variable,
-                                                     false,
-                                                     false);
-      mg_smoother->initialize(mg_operators, smoother_data);
+      transfer_block->copy_from_mg(dof_handler, dst, x);
+    }
 
-      if (additional_data.coarse_grid_smoother_type != "Smoother")
+    /** Tune the smoothers level by level, from the coarse to the fine
+     * levels, on the current level operators. For each smoother and pair
+     * of smoothing steps and damping, n_cycles V-cycles are applied to
+     * A u = 0 with a random initial guess on the level, and the setting
+     * with the largest reduction of the residual per unit of time, i.e.,
+     * -log(rate)/time, is kept. Chebyshev is only tried without damping.
+     * The coarse grid is not tuned. The result is stored in the per-level
+     * entries of the additional data and used by reinit(). The Vanka
+     * inverses of levels that use Chebyshev are released.
+     */
+    void
+    tune_smoothers(std::vector<unsigned int> const &candidate_steps,
+                   std::vector<double> const       &candidate_damping,
+                   std::vector<std::string> const  &candidate_smoothers = {
+                     "vanka"},
+                   unsigned int const n_cycles = 3)
+    {
+      AssertThrow(mg_smoother, ExcMessage("Call reinit() first."));
+      TimerOutput::Scope scope(timer, "tune_smoothers");
+
+      unsigned int const n_levels = max_level - min_level + 1;
+      additional_data.level_smoothing_steps.resize(
+        n_levels, additional_data.smoothing_steps);
+      additional_data.level_damping.resize(n_levels, 1.0);
+      additional_data.level_smoother.resize(n_levels, "vanka");
+
+      MGLevelObject<BlockVectorType> t(min_level, max_level),
+        d(min_level, max_level), c(min_level, max_level);
+      for (unsigned int l = min_level; l <= max_level; ++l)
+        for (auto *vec : {&t[l], &d[l], &c[l]})
+          mg_operators[l]->initialize_dof_vector(*vec);
+
+      MPI_Comm const comm = dof_handler.get_communicator();
+      for (unsigned int level = min_level + 1; level <= max_level; ++level)
         {
-          solver_control_coarse = std::make_unique<ReductionControl>(
-            additional_data.coarse_grid_maxiter,
-            additional_data.coarse_grid_abstol,
-            additional_data.coarse_grid_reltol,
-            false,
-            false);
-          typename SolverGMRES<BlockVectorType>::AdditionalData const
-            gmres_additional_data(10);
-          gmres_coarse = std::make_unique<SolverGMRES<BlockVectorType>>(
-            *solver_control_coarse, gmres_additional_data);
-
-          auto diagonal_matrix =
-            mg_operators[min_level]->get_matrix_diagonal_inverse();
-
-          typename PreconditionRelaxation<
-            LevelMatrixType,
-            DiagonalMatrix<BlockVectorType>>::AdditionalData coarse_precon_data;
-          coarse_precon_data.relaxation     = 0.9;
-          coarse_precon_data.n_iterations   = 1;
-          coarse_precon_data.preconditioner = diagonal_matrix;
-
-          preconditioner_coarse = std::make_unique<
-            PreconditionRelaxation<LevelMatrixType,
-                                   DiagonalMatrix<BlockVectorType>>>();
-          preconditioner_coarse->initialize(*(mg_operators[min_level]),
-                                            coarse_precon_data);
-
-          mg_coarse = std::make_unique<dealii::MGCoarseGridIterativeSolver<
-            BlockVectorType,
-            SolverGMRES<BlockVectorType>,
-            LevelMatrixType,
-            PreconditionRelaxation<LevelMatrixType,
-                                   DiagonalMatrix<BlockVectorType>>>>(
-            *gmres_coarse, *mg_operators[min_level], *preconditioner_coarse);
+          BlockVectorType u0, u, f, r;
+          for (auto *vec : {&u0, &u, &f, &r})
+            mg_operators[level]->initialize_dof_vector(*vec);
+          boost::random::mt19937 rng(boost::random::mt19937::default_seed);
+          boost::random::uniform_real_distribution<> uniform_distribution(-1,
+                                                                          1);
+          for (unsigned int b = 0; b < u0.n_blocks(); ++b)
+            {
+              for (unsigned int i = 0; i < u0.block(b).locally_owned_size();
+                   ++i)
+                u0.block(b).local_element(i) = uniform_distribution(rng);
+              mg_constraints[level]->set_zero(u0.block(b));
+            }
+          mg_matrix.vmult(level, r, u0);
+          double const r0 = r.l2_norm();
+
+          unsigned int const i          = level - min_level;
+          double             efficiency = -1.0;
+          for (auto const &smoother : candidate_smoothers)
+            for (auto const steps : candidate_steps)
+              for (auto const damping : candidate_damping)
+                {
+                  AssertThrow(smoother == "vanka" || smoother == "chebyshev",
+                              ExcMessage("Unknown smoother " + smoother));
+                  if ((smoother == "vanka" &&
+                       precondition_vanka[level]->empty()) ||
+                      (smoother == "chebyshev" &&
+                       damping != candidate_damping.front()))
+                    continue;
+                  mg_smoother->smoothers[level].initialize(
+                    *mg_operators[level],
+                    make_smoother_data(level, steps, damping, smoother));
+                  // Untimed V-cycle first: Chebyshev estimates its
+                  // eigenvalues on the first application
+                  u = u0;
+                  vcycle(level, u, f, t, d, c);
+                  u = u0;
+
+                  auto const start = std::chrono::steady_clock::now();
+                  for (unsigned int k = 0; k < n_cycles; ++k)
+                    vcycle(level, u, f, t, d, c);
+                  double const time = Utilities::MPI::max(
+                    std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                        .count() /
+                      n_cycles,
+                    comm);
+
+                  mg_matrix.vmult(level, r, u);
+                  double const rate =
+                    std::pow(r.l2_norm() / r0, 1.0 / n_cycles);
+                  double const e =
+                    rate < 1.0 ? -std::log(rate) / time : 0.0;
+                  deallog << "Tune smoother level " << level << ": "
+                          << smoother << " steps " << steps << " damping "
+                          << damping << " rate " << rate << " time " << time
+                          << std::endl;
+                  if (e > efficiency)
+                    {
+                      efficiency                                = e;
+                      additional_data.level_smoothing_steps[i] = steps;
+                      additional_data.level_damping[i]         = damping;
+                      additional_data.level_smoother[i]        = smoother;
+                    }
+                }
+          mg_smoother->smoothers[level].initialize(
+            *mg_operators[level],
+            make_smoother_data(level,
+                               additional_data.level_smoothing_steps[i],
+                               additional_data.level_damping[i],
+                               additional_data.level_smoother[i]));
         }
-      else
+      release_unused_vanka();
+    }
+
+    /** Print how the levels are distributed over the ranks. The table lists
+     * per level the coarsening that led to it (k, tau or space), the
+     * number of blocks and DoFs, the minimum, average and maximum of the
+     * locally owned cells and DoFs, and the maximum number of ghost DoFs and
+     * neighbour ranks of a block. One Vanka patch is built per owned cell,
+     * so the cells also describe the distribution of the patches. Levels
+     * whose maximum exceeds imbalance_threshold times the average are
+     * flagged.
+     */
+    void
+    print_hierarchy(ConditionalOStream &pcout,
+                    double const        imbalance_threshold) const
+    {
+      MPI_Comm const comm = dof_handler.get_communicator();
+      TableHandler   table;
+      for (unsigned int level = min_level; level <= max_level; ++level)
         {
-          mg_coarse =
-            std::make_unique<MGCoarseGridApplySmoother<BlockVectorType>>(
-              *mg_smoother);
+          BlockVectorType vec;
+          mg_operators[level]->initialize_dof_vector(vec);
+          auto const &partitioner = *vec.block(0).get_partitioner();
+
+          unsigned int n_cells = 0;
+          for (auto const &cell :
+               mg_dof_handlers[level]->active_cell_iterators())
+            if (cell->is_locally_owned())
+              ++n_cells;
+          std::set<unsigned int> neighbours;
+          for (auto const &[rank, n] : partitioner.ghost_targets())
+            neighbours.insert(rank);
+          for (auto const &[rank, n] : partitioner.import_targets())
+            neighbours.insert(rank);
+
+          auto const cells = Utilities::MPI::min_max_avg(n_cells, comm);
+          auto const dofs  = Utilities::MPI::min_max_avg(
+            vec.n_blocks() * partitioner.locally_owned_size(), comm);
+          double const imbalance =
+            std::max(cells.max / cells.avg, dofs.max / dofs.avg);
+
+          std::string type = "-";
+          if (level > min_level)
+            type = mg_type_level[level - 1] == TimeMGType::k   ? "k" :
+                   mg_type_level[level - 1] == TimeMGType::tau ? "tau" :
+                                                                 "space";
+
+          table.add_value("level", level);
+          table.add_value("type", type);
+          table.add_value("blocks", vec.n_blocks());
+          table.add_value("dofs", vec.size());
+          table.add_value("dofs_min", dofs.min);
+          table.add_value("dofs_avg", dofs.avg);
+          table.add_value("dofs_max", dofs.max);
+          table.add_value("cells_min", cells.min);
+          table.add_value("cells_avg", cells.avg);
+          table.add_value("cells_max", cells.max);
+          table.add_value("ghosts_max",
+                          Utilities::MPI::max(partitioner.n_ghost_indices(),
+                                              comm));
+          table.add_value("neighbours_max",
+                          Utilities::MPI::max(static_cast<unsigned int>(
+                                                neighbours.size()),
+                                              comm));
+          table.add_value("imbalance", imbalance);
+          table.add_value("flag",
+                          std::string(imbalance > imbalance_threshold ? "*" :
+                                                                        ""));
         }
+      table.set_precision("dofs_avg", 1);
+      table.set_precision("cells_avg", 1);
+      table.set_precision("imbalance", 2);
+      if (pcout.is_active())
+        table.write_text(pcout.get_stream());
+    }
 
-      // create multigrid algorithm (put level operators, smoothers, transfer
-      // operators and smoothers together)
-      mg = std::make_unique<Multigrid<BlockVectorType>>(mg_matrix,
-                                                        *mg_coarse,
-                                                        *transfer_block,
-                                                        *mg_smoother,
-                                                        *mg_smoother,
-                                                        min_level,
-                                                        max_level);
-
-      // convert multigrid algorithm to preconditioner
-      preconditioner =
-        std::make_unique<PreconditionMG<dim, BlockVectorType, MGTransferType>>(
-          dof_handler, *mg, *transfer_block);
+    const PreconditionerGMGAdditionalData &
+    get_additional_data() const
+    {
+      return additional_data;
     }
 
-    double
-    estimate_relaxation(unsigned level) const
-    {
-      if (level == 0)
-        return 1;
-
-      PreconditionerGMGAdditionalData additional_data;
-      using ChebyshevPreconditionerType =
-        PreconditionChebyshev<LevelMatrixType,
-                              BlockVectorType,
-                              SmootherPreconditionerType>;
-
-      typename ChebyshevPreconditionerType::AdditionalData
-        chebyshev_additional_data;
-      chebyshev_additional_data.preconditioner = precondition_vanka[level];
-      chebyshev_additional_data.smoothing_range =
-        additional_data.smoothing_range;
-      chebyshev_additional_data.degree = additional_data.smoothing_degree;
-      chebyshev_additional_data.eig_cg_n_iterations =
-        additional_data.smoothing_eig_cg_n_iterations;
-      chebyshev_additional_data.eigenvalue_algorithm =
-        ChebyshevPreconditionerType::AdditionalData::EigenvalueAlgorithm::
-          power_iteration;
-      chebyshev_additional_data.polynomial_type = ChebyshevPreconditionerType::
-        AdditionalData::PolynomialType::fourth_kind;
-      auto chebyshev = std::make_shared<ChebyshevPreconditionerType>();
-      chebyshev->initialize(*mg_operators[level], chebyshev_additional_data);
-
-      BlockVectorType vec;
-      mg_operators[level]->initialize_dof_vector(vec);
-
-      const auto evs = chebyshev->estimate_eigenvalues(vec);
-
-      const double alpha = (chebyshev_additional_data.smoothing_range > 1. ?
-                              evs.max_eigenvalue_estimate /
-                                chebyshev_additional_data.smoothing_range :
-                              std::min(0.9 * evs.max_eigenvalue_estimate,
-                                       evs.min_eigenvalue_estimate));
-
-      double omega = 2.0 / (alpha + evs.max_eigenvalue_estimate);
-      deallog << "\n-Eigenvalue estimation level " << level
-              << ":\n"
-                 "    Relaxation parameter: "
-              << omega
-              << "\n"
-                 "    Minimum eigenvalue: "
-              << evs.min_eigenvalue_estimate
-              << "\n"
-                 "    Maximum eigenvalue: "
-              << evs.max_eigenvalue_estimate << std::endl;
-
-      return omega;
+    /** Operator on the finest level, i.e., the outer space-time operator
+     * in the precision of the preconditioner
+     */
+    const LevelMatrixType &
+    get_fine_matrix() const
+    {
+      return *mg_operators[max_level];
     }
 
-    template <typename SolutionVectorType = BlockVectorType>
+    /** Copy with its own mutable state, e.g., for independent solves of
+     * several right-hand sides. The level operators and the Vanka
+     * preconditioners are copied cheaply, sharing the matrix-free data, the
+     * patches, the inverses and the relaxation parameters, but record their
+     * timings in timer. The copy has its own smoothers, coarse grid solver,
+     * level vectors and transfers. The transfers are rebuilt, since
+     * MGTwoLevelTransfer keeps temporary vectors. reinit() has to be called
+     * on this object before.
+     *
+     * The copies use the communicator of the DoFHandler with the same
+     * message tags. With more than one rank, they must not be applied
+     * concurrently from several threads, since their ghost exchanges could
+     * match each other's messages. They can be applied one after another.
+     */
+    std::unique_ptr<const GMG<dim, Number, LevelMatrixType>>
+    clone(TimerOutput &timer) const;
+
+  private:
+    // Smoothers, coarse grid solver and multigrid algorithm for the
+    // current relaxation parameters
     void
-    vmult(SolutionVectorType &dst, const SolutionVectorType &src) const
+    setup_multigrid() const;
+
+    typename SmootherType::AdditionalData
+    make_smoother_data(unsigned int const level,
+                       unsigned int const steps,
+                       double const       damping,
+                       std::string const &smoother) const
     {
-      TimerOutput::Scope scope(timer, "gmg");
-      if (std::is_same_v<SolutionVectorType, BlockVectorType>)
-        preconditioner->vmult(dst, src);
+      typename SmootherType::AdditionalData data;
+      data.use_chebyshev = smoother == "chebyshev";
+      if (data.use_chebyshev)
+        {
+          auto &chebyshev = data.chebyshev;
+          chebyshev.preconditioner =
+            mg_operators[level]->get_matrix_diagonal_inverse();
+          chebyshev.degree          = steps * additional_data.smoothing_degree;
+          chebyshev.smoothing_range = additional_data.chebyshev_smoothing_range;
+          chebyshev.eig_cg_n_iterations =
+            additional_data.smoothing_eig_cg_n_iterations;
+          // The space-time operators are not symmetric
+          using ChebyshevData = typename SmootherType::ChebyshevType::
+            AdditionalData;
+          chebyshev.eigenvalue_algorithm =
+            ChebyshevData::EigenvalueAlgorithm::power_iteration;
+          chebyshev.polynomial_type =
+            ChebyshevData::PolynomialType::fourth_kind;
+        }
       else
         {
-          src_->copy_locally_owned_data_from(src);
-          preconditioner->vmult(*dst_, *src_);
-          dst.copy_locally_owned_data_from(*dst_);
+          auto &vanka          = data.relaxation;
+          vanka.preconditioner = precondition_vanka[level];
+          vanka.n_iterations   = steps;
+          vanka.relaxation     = damping * relaxation[level];
         }
+      return data;
     }
 
-    std::unique_ptr<const GMG<dim, Number, LevelMatrixType>>
-    clone() const
+    std::string
+    level_smoother(unsigned int const level) const
     {
-      return std::make_unique<GMG<dim, Number, LevelMatrixType>>(
-        dof_handler, mg_dof_handlers, mg_constraints, mg_operators);
+      unsigned int const i = level - min_level;
+      std::string const  smoother = i < additional_data.level_smoother.size() ?
+                                      additional_data.level_smoother[i] :
+                                      "vanka";
+      AssertThrow(smoother == "vanka" || smoother == "chebyshev",
+                  ExcMessage("Unknown smoother " + smoother));
+      return smoother;
+    }
+
+    // Drop the Vanka inverses and patches of the levels smoothed by
+    // Chebyshev. Later updates of these Vanka preconditioners do nothing.
+    void
+    release_unused_vanka() const
+    {
+      for (unsigned int level = min_level; level <= max_level; ++level)
+        if (level_smoother(level) == "chebyshev")
+          precondition_vanka[level]->clear();
+    }
+
+    // V-cycle on level for A u = f with initial guess u, using the levels
+    // below as scratch: t for the residual, d and c for the coarse defect
+    // and correction. The coarse grid solver starts from zero.
+    void
+    vcycle(unsigned int const              level,
+           BlockVectorType                &u,
+           BlockVectorType const          &f,
+           MGLevelObject<BlockVectorType> &t,
+           MGLevelObject<BlockVectorType> &d,
+           MGLevelObject<BlockVectorType> &c) const
+    {
+      if (level == min_level)
+        {
+          (*mg_coarse)(level, u, f);
+          return;
+        }
+      mg_smoother->smooth(level, u, f);
+      mg_matrix.vmult(level, t[level], u);
+      t[level].sadd(-1.0, 1.0, f);
+      d[level - 1] = 0.0;
+      transfer_block->restrict_and_add(level, d[level - 1], t[level]);
+      c[level - 1] = 0.0;
+      vcycle(level - 1, c[level - 1], d[level - 1], t, d, c);
+      transfer_block->prolongate_and_add(level, u, c[level - 1]);
+      mg_smoother->smooth(level, u, f);
     }
 
-  private:
     TimerOutput &timer;
 
     PreconditionerGMGAdditionalData additional_data;
@@ -879,7 +1625,11 @@ namespace dealii
                                                                 mg_constraints;
     const MGLevelObject<std::shared_ptr<const LevelMatrixType>> mg_operators;
     const MGLevelObject<std::shared_ptr<SmootherPreconditionerType>>
-      precondition_vanka;
+                                  precondition_vanka;
+    const std::vector<TimeMGType> mg_type_level;
+    const TimeStepType            time_step_type;
+    const unsigned int            r;
+    const unsigned int            n_timesteps_at_once;
 
     const unsigned int min_level;
     const unsigned int max_level;
@@ -888,6 +1638,9 @@ namespace dealii
 
     mutable mg::Matrix<BlockVectorType> mg_matrix;
 
+    // Relaxation parameters of the smoothers before the damping
+    mutable MGLevelObject<double> relaxation;
+
 
     mutable std::unique_ptr<MGSmootherType> mg_smoother;
 
@@ -904,4 +1657,384 @@ namespace dealii
       PreconditionMG<dim, BlockVectorType, MGTransferType>>
       preconditioner;
   };
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  GMG<dim, Number, LevelMatrixType>::GMG(
+    TimerOutput                   &timer,
+    Parameters<dim> const         &parameters,
+    unsigned int const             r,
+    unsigned int const             n_timesteps_at_once,
+    const std::vector<TimeMGType> &mg_type_level,
+    const DoFHandler<dim>         &dof_handler,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<dim>>>
+      &mg_dof_handlers,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<Number>>>
+      &mg_constraints,
+    const MGLevelObject<std::shared_ptr<const LevelMatrixType>> &mg_operators,
+    const MGLevelObject<std::shared_ptr<SmootherPreconditionerType>>
+                                      &mg_smoother_,
+    std::unique_ptr<BlockVectorType> &&tmp1,
+    std::unique_ptr<BlockVectorType> &&tmp2)
+    : timer(timer)
+    , additional_data(parameters.mg_data)
+    , src_(std::move(tmp1))
+    , dst_(std::move(tmp2))
+    , dof_handler(dof_handler)
+    , mg_dof_handlers(mg_dof_handlers)
+    , mg_constraints(mg_constraints)
+    , mg_operators(mg_operators)
+    , precondition_vanka(mg_smoother_)
+    , mg_type_level(mg_type_level)
+    , time_step_type(parameters.type)
+    , r(r)
+    , n_timesteps_at_once(n_timesteps_at_once)
+    , min_level(mg_dof_handlers.min_level())
+    , max_level(mg_dof_handlers.max_level())
+  {
+    transfer_block = build_stmg_transfers<dim, Number>(
+      parameters.type,
+      r,
+      n_timesteps_at_once,
+      mg_dof_handlers,
+      mg_constraints,
+      [&](const unsigned int l, VectorType &vec) {
+        this->mg_operators[l]->initialize_dof_vector(vec);
+      },
+      additional_data.restrict_is_transpose_prolongate,
+      mg_type_level);
+    for (unsigned int level = min_level; level <= max_level; ++level)
+      precondition_vanka[level]->set_float_inverses(
+        additional_data.float_vanka_inverses);
+    release_unused_vanka();
+  }
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  void
+  GMG<dim, Number, LevelMatrixType>::reinit() const
+  {
+    relaxation.resize(min_level, max_level);
+    for (unsigned int level = min_level; level <= max_level; ++level)
+      relaxation[level] = additional_data.estimate_relaxation &&
+                                level_smoother(level) == "vanka" ?
+                            estimate_relaxation(level) :
+                            1.0;
+    setup_multigrid();
+  }
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  double
+  GMG<dim, Number, LevelMatrixType>::estimate_relaxation(unsigned level) const
+  {
+    if (level == 0)
+      return 1;
+
+    PreconditionerGMGAdditionalData additional_data;
+    using ChebyshevPreconditionerType =
+      PreconditionChebyshev<LevelMatrixType,
+                            BlockVectorType,
+                            SmootherPreconditionerType>;
+
+    typename ChebyshevPreconditionerType::AdditionalData
+      chebyshev_additional_data;
+    chebyshev_additional_data.preconditioner = precondition_vanka[level];
+    chebyshev_additional_data.smoothing_range =
+      additional_data.smoothing_range;
+    chebyshev_additional_data.degree = additional_data.smoothing_degree;
+    chebyshev_additional_data.eig_cg_n_iterations =
+      additional_data.smoothing_eig_cg_n_iterations;
+    chebyshev_additional_data.eigenvalue_algorithm =
+      ChebyshevPreconditionerType::AdditionalData::EigenvalueAlgorithm::
+        power_iteration;
+    chebyshev_additional_data.polynomial_type = ChebyshevPreconditionerType::
+      AdditionalData::PolynomialType::fourth_kind;
+    auto chebyshev = std::make_shared<ChebyshevPreconditionerType>();
+    chebyshev->initialize(*mg_operators[level], chebyshev_additional_data);
+
+    BlockVectorType vec;
+    mg_operators[level]->initialize_dof_vector(vec);
+
+    const auto evs = chebyshev->estimate_eigenvalues(vec);
+
+    const double alpha = (chebyshev_additional_data.smoothing_range > 1. ?
+                            evs.max_eigenvalue_estimate /
+                              chebyshev_additional_data.smoothing_range :
+                            std::min(0.9 * evs.max_eigenvalue_estimate,
+                                     evs.min_eigenvalue_estimate));
+
+    double omega = 2.0 / (alpha + evs.max_eigenvalue_estimate);
+    deallog << "\n-Eigenvalue estimation level " << level
+            << ":\n"
+               "    Relaxation parameter: "
+            << omega
+            << "\n"
+               "    Minimum eigenvalue: "
+            << evs.min_eigenvalue_estimate
+            << "\n"
+               "    Maximum eigenvalue: "
+            << evs.max_eigenvalue_estimate << std::endl;
+
+    return omega;
+  }
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  template <typename SolutionVectorType>
+  void
+  GMG<dim, Number, LevelMatrixType>::vmult(SolutionVectorType       &dst,
+                                           const SolutionVectorType &src) const
+  {
+    TimerOutput::Scope scope(timer, "gmg");
+    TraceScope         trace("vcycle", "mg");
+    if (std::is_same_v<SolutionVectorType, BlockVectorType>)
+      preconditioner->vmult(dst, src);
+    else
+      {
+        src_->copy_locally_owned_data_from(src);
+        preconditioner->vmult(*dst_, *src_);
+        dst.copy_locally_owned_data_from(*dst_);
+      }
+  }
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  std::unique_ptr<const GMG<dim, Number, LevelMatrixType>>
+  GMG<dim, Number, LevelMatrixType>::clone(TimerOutput &timer) const
+  {
+    Assert(relaxation.n_levels() > 0, ExcMessage("Call reinit() first."));
+    MGLevelObject<std::shared_ptr<const LevelMatrixType>> operators(
+      min_level, max_level);
+    MGLevelObject<std::shared_ptr<SmootherPreconditionerType>> vanka(
+      min_level, max_level);
+    for (unsigned int l = min_level; l <= max_level; ++l)
+      {
+        operators[l] =
+          std::make_shared<LevelMatrixType>(timer, *mg_operators[l]);
+        vanka[l] = std::make_shared<SmootherPreconditionerType>(
+          timer, *precondition_vanka[l]);
+      }
+    std::unique_ptr<BlockVectorType> tmp1, tmp2;
+    if (src_)
+      {
+        tmp1 = std::make_unique<BlockVectorType>();
+        tmp2 = std::make_unique<BlockVectorType>();
+        operators[max_level]->initialize_dof_vector(*tmp1);
+        operators[max_level]->initialize_dof_vector(*tmp2);
+      }
+
+    Parameters<dim> parameters;
+    parameters.type    = time_step_type;
+    parameters.mg_data = additional_data;
+    auto copy = std::make_unique<GMG<dim, Number, LevelMatrixType>>(
+      timer,
+      parameters,
+      r,
+      n_timesteps_at_once,
+      mg_type_level,
+      dof_handler,
+      mg_dof_handlers,
+      mg_constraints,
+      operators,
+      vanka,
+      std::move(tmp1),
+      std::move(tmp2));
+    copy->relaxation = relaxation;
+    copy->setup_multigrid();
+    return copy;
+  }
+
+  template <int dim, typename Number, typename LevelMatrixType>
+  void
+  GMG<dim, Number, LevelMatrixType>::setup_multigrid() const
+  {
+    // wrap level operators
+    mg_matrix = mg::Matrix<BlockVectorType>(mg_operators);
+
+    MGLevelObject<typename SmootherType::AdditionalData> smoother_data(
+      min_level, max_level);
+
+    // setup smoothers on each level
+    for (unsigned int level = min_level; level <= max_level; ++level)
+      {
+        unsigned int const i = level - min_level;
+        smoother_data[level] = make_smoother_data(
+          level,
+          i < additional_data.level_smoothing_steps.size() ?
+            additional_data.level_smoothing_steps[i] :
+            additional_data.smoothing_steps,
+          i < additional_data.level_damping.size() ?
+            additional_data.level_damping[i] :
+            1.0,
+          level_smoother(level));
+      }
+    mg_smoother = std::make_unique<MGSmootherType>(1,
+                                                   additional_data.variable,
+                                                   false,
+                                                   false);
+    mg_smoother->initialize(mg_operators, smoother_data);
+
+    if (additional_data.coarse_grid_smoother_type != "Smoother")
+      {
+        solver_control_coarse = std::make_unique<ReductionControl>(
+          additional_data.coarse_grid_maxiter,
+          additional_data.coarse_grid_abstol,
+          additional_data.coarse_grid_reltol,
+          false,
+          false);
+        typename SolverGMRES<BlockVectorType>::AdditionalData const
+          gmres_additional_data(10);
+        gmres_coarse = std::make_unique<SolverGMRES<BlockVectorType>>(
+          *solver_control_coarse, gmres_additional_data);
+
+        auto diagonal_matrix =
+          mg_operators[min_level]->get_matrix_diagonal_inverse();
+
+        typename PreconditionRelaxation<
+          LevelMatrixType,
+          DiagonalMatrix<BlockVectorType>>::AdditionalData coarse_precon_data;
+        coarse_precon_data.relaxation     = 0.9;
+        coarse_precon_data.n_iterations   = 1;
+        coarse_precon_data.preconditioner = diagonal_matrix;
+
+        preconditioner_coarse = std::make_unique<
+          PreconditionRelaxation<LevelMatrixType,
+                                 DiagonalMatrix<BlockVectorType>>>();
+        preconditioner_coarse->initialize(*(mg_operators[min_level]),
+                                          coarse_precon_data);
+
+        mg_coarse = std::make_unique<dealii::MGCoarseGridIterativeSolver<
+          BlockVectorType,
+          SolverGMRES<BlockVectorType>,
+          LevelMatrixType,
+          PreconditionRelaxation<LevelMatrixType,
+                                 DiagonalMatrix<BlockVectorType>>>>(
+          *gmres_coarse, *mg_operators[min_level], *preconditioner_coarse);
+      }
+    else
+      {
+        mg_coarse =
+          std::make_unique<MGCoarseGridApplySmoother<BlockVectorType>>(
+            *mg_smoother);
+      }
+#ifdef LOD_PROFILE_MPI
+    mg_coarse = std::make_unique<MGCoarseGridProfiled<BlockVectorType>>(
+      std::move(mg_coarse));
+#endif
+
+    // create multigrid algorithm (put level operators, smoothers, transfer
+    // operators and smoothers together)
+    mg = std::make_unique<Multigrid<BlockVectorType>>(mg_matrix,
+                                                      *mg_coarse,
+                                                      *transfer_block,
+                                                      *mg_smoother,
+                                                      *mg_smoother,
+                                                      min_level,
+                                                      max_level);
+
+    // timeline of the V-cycle per level
+    if (TraceRecorder::instance().is_enabled())
+      {
+        auto const trace = [](char const *name) {
+          return [name](bool const start, unsigned int const level) {
+            auto &recorder = TraceRecorder::instance();
+            if (!recorder.is_enabled())
+              return;
+            if (start)
+              recorder.begin(name, "mg", level);
+            else
+              recorder.end(name, "mg", level);
+          };
+        };
+        mg->connect_pre_smoother_step(trace("pre_smooth"));
+        mg->connect_residual_step(trace("residual"));
+        mg->connect_restriction(trace("restrict"));
+        mg->connect_coarse_solve(trace("coarse_solve"));
+        mg->connect_prolongation(trace("prolongate"));
+        mg->connect_post_smoother_step(trace("post_smooth"));
+      }
+
+    // convert multigrid algorithm to preconditioner
+    preconditioner =
+      std::make_unique<PreconditionMG<dim, BlockVectorType, MGTransferType>>(
+        dof_handler, *mg, *transfer_block);
+  }
+
+#ifdef LOD_PRECOMPILED_KERNELS
+  // Instantiated in source/gmg.cc
+  extern template class VankaPatchData<double>;
+  extern template class PreconditionVanka<double>;
+  extern template class MGTwoLevelTransferST<double>;
+  extern template class VankaPatchData<float>;
+  extern template class PreconditionVanka<float>;
+  extern template class MGTwoLevelTransferST<float>;
+
+  extern template class MGTwoLevelBlockTransfer<2, double>;
+  extern template class TwoLevelTransferOperator<2, double>;
+  extern template class STMGTransferBlockMatrixFree<2, double>;
+  extern template VankaPatchData<double>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<2>> const &,
+    std::vector<DoFHandler<2>::cell_iterator> const &);
+  extern template PreconditionVanka<double>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<double> &,
+    const FullMatrix<double> &,
+    std::shared_ptr<const DoFHandler<2>> const &);
+
+  extern template class MGTwoLevelBlockTransfer<2, float>;
+  extern template class TwoLevelTransferOperator<2, float>;
+  extern template class STMGTransferBlockMatrixFree<2, float>;
+  extern template VankaPatchData<float>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<2>> const &,
+    std::vector<DoFHandler<2>::cell_iterator> const &);
+  extern template PreconditionVanka<float>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<float> &,
+    const FullMatrix<float> &,
+    std::shared_ptr<const DoFHandler<2>> const &);
+
+  extern template class MGTwoLevelBlockTransfer<3, double>;
+  extern template class TwoLevelTransferOperator<3, double>;
+  extern template class STMGTransferBlockMatrixFree<3, double>;
+  extern template VankaPatchData<double>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<3>> const &,
+    std::vector<DoFHandler<3>::cell_iterator> const &);
+  extern template PreconditionVanka<double>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<double> &,
+    const FullMatrix<double> &,
+    std::shared_ptr<const DoFHandler<3>> const &);
+
+  extern template class MGTwoLevelBlockTransfer<3, float>;
+  extern template class TwoLevelTransferOperator<3, float>;
+  extern template class STMGTransferBlockMatrixFree<3, float>;
+  extern template VankaPatchData<float>::VankaPatchData(
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    std::shared_ptr<const DoFHandler<3>> const &,
+    std::vector<DoFHandler<3>::cell_iterator> const &);
+  extern template PreconditionVanka<float>::PreconditionVanka(
+    TimerOutput &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparseMatrixType> const &,
+    std::shared_ptr<const SparsityPatternType> const &,
+    const FullMatrix<float> &,
+    const FullMatrix<float> &,
+    std::shared_ptr<const DoFHandler<3>> const &);
+#endif
 } // namespace dealii
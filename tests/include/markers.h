@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#pragma once
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/table_handler.h>
+
+#ifdef LOD_REGION_MARKERS
+#  ifdef LIKWID_PERFMON
+#    include <likwid-marker.h>
+#  elif defined(__linux__)
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#  endif
+#endif
+
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dealii
+{
+  /** Hardware counters of a marked region: number of calls, cycles,
+   * instructions and last level cache misses
+   */
+  using RegionCounters = std::array<unsigned long long, 4>;
+
+#if defined(LOD_REGION_MARKERS) && !defined(LIKWID_PERFMON) && \
+  defined(__linux__)
+  /** Group of cycles, instructions and cache misses of the calling thread,
+   * read through perf_event_open. If the kernel does not permit access, the
+   * counters read as zero.
+   */
+  class PerfCounterGroup
+  {
+  public:
+    PerfCounterGroup()
+    {
+      std::array<std::uint64_t, 3> const configs = {
+        {PERF_COUNT_HW_CPU_CYCLES,
+         PERF_COUNT_HW_INSTRUCTIONS,
+         PERF_COUNT_HW_CACHE_MISSES}};
+      for (unsigned int i = 0; i < configs.size(); ++i)
+        {
+          perf_event_attr attr;
+          std::memset(&attr, 0, sizeof(attr));
+          attr.type           = PERF_TYPE_HARDWARE;
+          attr.size           = sizeof(attr);
+          attr.config         = configs[i];
+          attr.disabled       = i == 0;
+          attr.exclude_kernel = 1;
+          attr.exclude_hv     = 1;
+          attr.read_format    = PERF_FORMAT_GROUP;
+          fds[i]              = syscall(
+            __NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+        }
+      if (fds[0] >= 0)
+        {
+          ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+          ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    ~PerfCounterGroup()
+    {
+      for (auto const fd : fds)
+        if (fd >= 0)
+          close(fd);
+    }
+
+    void
+    read(std::array<std::uint64_t, 3> &values) const
+    {
+      struct
+      {
+        std::uint64_t n;
+        std::uint64_t values[3];
+      } data;
+      if (fds[0] >= 0 && ::read(fds[0], &data, sizeof(data)) == sizeof(data))
+        std::copy(data.values, data.values + 3, values.begin());
+      else
+        values.fill(0);
+    }
+
+  private:
+    std::array<int, 3> fds = {{-1, -1, -1}};
+  };
+#endif
+
+  inline std::map<std::string, RegionCounters> &
+  region_counters()
+  {
+    static std::map<std::string, RegionCounters> counters;
+    return counters;
+  }
+
+  /** Marker of a hot region like the Vanka patch loop or the cell loop of
+   * an operator. With LOD_REGION_MARKERS, the region is passed to the
+   * LIKWID marker API if LIKWID_PERFMON is set, and otherwise the hardware
+   * counters are read through perf_event_open at begin and end of the
+   * region. Without LOD_REGION_MARKERS, this does nothing. The name has to
+   * be a string literal.
+   */
+  class RegionMarker
+  {
+  public:
+#if defined(LOD_REGION_MARKERS) && defined(LIKWID_PERFMON)
+    explicit RegionMarker(char const *name)
+      : name(name)
+    {
+      LIKWID_MARKER_START(name);
+    }
+
+    ~RegionMarker()
+    {
+      LIKWID_MARKER_STOP(name);
+    }
+
+  private:
+    char const *name;
+#elif defined(LOD_REGION_MARKERS) && defined(__linux__)
+    explicit RegionMarker(char const *name)
+      : name(name)
+    {
+      group().read(start);
+    }
+
+    ~RegionMarker()
+    {
+      std::array<std::uint64_t, 3> end;
+      group().read(end);
+      static std::mutex           mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      auto                       &counters = region_counters()[name];
+      ++counters[0];
+      for (unsigned int i = 0; i < 3; ++i)
+        counters[i + 1] += end[i] - start[i];
+    }
+
+  private:
+    static PerfCounterGroup const &
+    group()
+    {
+      thread_local PerfCounterGroup const group;
+      return group;
+    }
+
+    char const                  *name;
+    std::array<std::uint64_t, 3> start;
+#else
+    explicit RegionMarker(char const *)
+    {}
+#endif
+  };
+
+  inline void
+  initialize_region_markers()
+  {
+#if defined(LOD_REGION_MARKERS) && defined(LIKWID_PERFMON)
+    LIKWID_MARKER_INIT;
+#endif
+  }
+
+  inline void
+  finalize_region_markers()
+  {
+#if defined(LOD_REGION_MARKERS) && defined(LIKWID_PERFMON)
+    LIKWID_MARKER_CLOSE;
+#endif
+  }
+
+  /** Print the counters of the regions summed over all ranks, with the
+   * instructions per cycle and the memory traffic estimated as one cache
+   * line per last level cache miss, and reset them. With LIKWID, the
+   * results are reported by likwid-perfctr instead.
+   */
+  inline void
+  print_region_markers(ConditionalOStream &pcout, MPI_Comm const comm)
+  {
+#if defined(LOD_REGION_MARKERS) && !defined(LIKWID_PERFMON)
+    std::map<std::string, std::vector<unsigned long long>> local;
+    for (auto const &[name, values] : region_counters())
+      local[name].assign(values.begin(), values.end());
+    region_counters().clear();
+    auto const all_counters = Utilities::MPI::gather(comm, local);
+
+    std::map<std::string, RegionCounters> sum;
+    for (auto const &counters : all_counters)
+      for (auto const &[name, values] : counters)
+        for (unsigned int i = 0; i < values.size(); ++i)
+          sum[name][i] += values[i];
+    if (sum.empty())
+      return;
+
+    TableHandler table;
+    for (auto const &[name, values] : sum)
+      {
+        table.add_value("region", name);
+        table.add_value("calls", values[0]);
+        table.add_value("cycles", values[1]);
+        table.add_value("instructions", values[2]);
+        table.add_value("ipc",
+                        values[1] > 0 ? static_cast<double>(values[2]) /
+                                          static_cast<double>(values[1]) :
+                                        0.0);
+        table.add_value("llc_misses", values[3]);
+        table.add_value("llc_bytes", 64 * values[3]);
+      }
+    table.set_precision("ipc", 2);
+    if (pcout.is_active())
+      table.write_text(pcout.get_stream());
+    pcout << std::endl;
+#else
+    (void)pcout;
+    (void)comm;
+#endif
+  }
+} // namespace dealii
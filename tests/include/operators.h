@@ -5,6 +5,8 @@
 
 #include <deal.II/base/subscriptor.h>
 
+#include <deal.II/fe/fe_values.h>
+
 #include <deal.II/matrix_free/fe_evaluation.h>
 #include <deal.II/matrix_free/matrix_free.h>
 #include <deal.II/matrix_free/tools.h>
@@ -12,6 +14,8 @@
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
 
+#include "communication.h"
+#include "markers.h"
 #include "types.h"
 
 namespace dealii
@@ -91,6 +95,19 @@ namespace dealii
       AssertDimension(Alpha.m(), Beta.m());
       AssertDimension(Alpha.n(), Beta.n());
     }
+
+    /** Copy of other that records its timings in timer instead. Both share
+     * the spatial operators and their communicator, see GMG::clone().
+     */
+    SystemMatrix(TimerOutput &timer, SystemMatrix const &other)
+      : timer(timer)
+      , K(other.K)
+      , M(other.M)
+      , Alpha(other.Alpha)
+      , Beta(other.Beta)
+      , alpha_is_zero(other.alpha_is_zero)
+      , beta_is_zero(other.beta_is_zero)
+    {}
     void
     vmult(BlockVectorType &dst, const BlockVectorType &src) const
     {
@@ -197,21 +214,23 @@ namespace dealii
                             Beta(i, i),
                             M.get_matrix_diagonal()->get_vector());
         }
+      vec.collect_sizes();
       return std::make_shared<DiagonalMatrix<BlockVectorType>>(vec);
     }
 
+    // Inverse of the diagonal above, used for point Jacobi. Entries below
+    // sqrt(eps) times the largest one belong to constrained DoFs.
     std::shared_ptr<DiagonalMatrix<BlockVectorType>>
     get_matrix_diagonal_inverse() const
     {
-      BlockVectorType vec(Alpha.m());
+      auto  diagonal = get_matrix_diagonal();
+      auto &vec      = diagonal->get_vector();
+      Number const tol =
+        std::sqrt(std::numeric_limits<Number>::epsilon()) * vec.linfty_norm();
       for (unsigned int i = 0; i < Alpha.m(); ++i)
-        {
-          vec.block(i) = K.get_matrix_diagonal_inverse()->get_vector();
-          vec.block(i).sadd(1. / Alpha(i, i),
-                            1. / Beta(i, i),
-                            M.get_matrix_diagonal_inverse()->get_vector());
-        }
-      return std::make_shared<DiagonalMatrix<BlockVectorType>>(vec);
+        for (auto &entry : vec.block(i))
+          entry = std::abs(entry) > tol ? Number(1.) / entry : Number(1.);
+      return diagonal;
     }
 
     types::global_dof_index
@@ -263,6 +282,7 @@ namespace dealii
     Point<dim>         lower_left;
     Point<dim>         step_size;
     Table<dim, double> distortion;
+    Tensor<1, dim>     velocity;
 
     template <typename number>
     double
@@ -278,6 +298,15 @@ namespace dealii
       return c1;
     }
 
+    // Index of the distortion cell containing x in direction d
+    unsigned int
+    distortion_index(double const x, unsigned int const d) const
+    {
+      int const i =
+        static_cast<int>(std::floor((x - lower_left[d]) / step_size[d]));
+      return std::clamp(i, 0, static_cast<int>(distortion.size(d)) - 1);
+    }
+
 
   public:
     Coefficient(Parameters<dim> const &params,
@@ -289,6 +318,7 @@ namespace dealii
       , c3(c3_)
       , distorted(params.distort_coeff != 0.0)
       , lower_left(params.hyperrect_lower_left)
+      , velocity(params.coefficient_velocity)
     {
       if (distorted)
         {
@@ -314,71 +344,105 @@ namespace dealii
         }
     }
 
+    /** The material moves with a constant velocity, so the coefficient
+     * depends on the time set by set_time()
+     */
+    bool
+    is_time_dependent() const
+    {
+      return velocity.norm() != 0.0;
+    }
+
     virtual double
     value(const Point<dim> &p, const unsigned int /*component*/) const override
     {
-      return get_coefficient(p[0], p[1]);
+      auto const shift = this->get_time() * velocity;
+      return get_coefficient(p[0] - shift[0], p[1] - shift[1]);
     }
 
     template <typename number>
     number
     value(const Point<dim, number> &p) const
     {
-      number value;
-      auto   v = value.begin();
+      auto const shift = this->get_time() * velocity;
+      number     value;
+      auto       v = value.begin();
       if constexpr (dim == 2)
         for (auto px = p[0].begin(), py = p[1].begin(); px != p[0].end();
              ++px, ++py, ++v)
           {
-            *v = get_coefficient(*px, *py);
+            double const x = *px - shift[0], y = *py - shift[1];
+            *v             = get_coefficient(x, y);
             if (distorted)
-              *v *= distortion(
-                static_cast<unsigned>((*px - lower_left[0]) / step_size[0]),
-                static_cast<unsigned>((*py - lower_left[1]) / step_size[1]));
+              *v *= distortion(distortion_index(x, 0), distortion_index(y, 1));
           }
       else
         for (auto px = p[0].begin(), py = p[1].begin(), pz = p[2].begin();
              px != p[0].end();
              ++px, ++py, ++pz, ++v)
           {
-            *v = get_coefficient(*px, *py);
+            double const x = *px - shift[0], y = *py - shift[1],
+                         z = *pz - shift[2];
+            *v             = get_coefficient(x, y);
             if (distorted)
-              *v *= distortion(
-                static_cast<unsigned>((*px - lower_left[0]) / step_size[0]),
-                static_cast<unsigned>((*py - lower_left[1]) / step_size[1]),
-                static_cast<unsigned>((*pz - lower_left[2]) / step_size[2]));
+              *v *= distortion(distortion_index(x, 0),
+                               distortion_index(y, 1),
+                               distortion_index(z, 2));
           }
       return value;
     }
   };
 
   template <int dim, typename Number>
-  class MatrixFreeOperator
+  class MatrixFreeOperator : public Subscriptor
   {
   public:
     using BlockVectorType = BlockVectorT<Number>;
     using VectorType      = VectorT<Number>;
 
+    /** With @p lean_setup, MatrixFree only stores the mapping data the
+     * operator needs (values for the mass part, gradients for the Laplace
+     * part) and no quadrature points. The coefficient is then evaluated with a
+     * temporary FEValues object.
+     */
     MatrixFreeOperator(const Mapping<dim>              &mapping,
                        const DoFHandler<dim>           &dof_handler,
                        const AffineConstraints<Number> &constraints,
                        const Quadrature<dim>           &quadrature,
                        const double                     mass_matrix_scaling,
-                       const double                     laplace_matrix_scaling)
+                       const double                     laplace_matrix_scaling,
+                       const bool                       lean_setup = false)
       : mass_matrix_scaling(mass_matrix_scaling)
       , laplace_matrix_scaling(laplace_matrix_scaling)
       , has_mass_coefficient(false)
       , has_laplace_coefficient(false)
+      , lean_setup(lean_setup)
+      , mapping(&mapping)
+      , quadrature(quadrature)
     {
       mass_matrix_coefficient.clear();
       laplace_matrix_coefficient.clear();
       typename MatrixFree<dim, Number>::AdditionalData additional_data;
-      additional_data.mapping_update_flags =
-        update_values | update_gradients | update_quadrature_points;
+      if (lean_setup)
+        {
+          additional_data.mapping_update_flags = update_default;
+          if (mass_matrix_scaling != 0.0)
+            additional_data.mapping_update_flags |= update_values;
+          if (laplace_matrix_scaling != 0.0)
+            additional_data.mapping_update_flags |= update_gradients;
+        }
+      else
+        additional_data.mapping_update_flags =
+          update_values | update_gradients | update_quadrature_points;
 
       matrix_free.reinit(
         mapping, dof_handler, constraints, quadrature, additional_data);
 
+      int const degree = dof_handler.get_fe().tensor_degree();
+      if (degree <= max_kernel_degree &&
+          quadrature.size() == Utilities::pow<unsigned int>(degree + 1, dim))
+        kernel_degree = degree;
+
       compute_diagonal();
     }
 
@@ -390,22 +454,10 @@ namespace dealii
     }
 
     void
-    vmult(VectorType &dst, const VectorType &src) const
-    {
-      matrix_free.cell_loop(
-        &MatrixFreeOperator::do_cell_integral_range, this, dst, src, true);
-    }
+    vmult(VectorType &dst, const VectorType &src) const;
 
     void
-    compute_system_matrix(SparseMatrixType &sparse_matrix) const
-    {
-      MatrixFreeTools::compute_matrix(
-        matrix_free,
-        matrix_free.get_affine_constraints(),
-        sparse_matrix,
-        &MatrixFreeOperator::do_cell_integral_local,
-        this);
-    }
+    compute_system_matrix(SparseMatrixType &sparse_matrix) const;
 
     std::shared_ptr<DiagonalMatrix<VectorType>> const &
     get_matrix_diagonal() const
@@ -419,6 +471,12 @@ namespace dealii
       return diagonal_inverse;
     }
 
+    MatrixFree<dim, Number> const &
+    get_matrix_free() const
+    {
+      return matrix_free;
+    }
+
     types::global_dof_index
     m() const
     {
@@ -442,48 +500,297 @@ namespace dealii
       if (laplace_matrix_scaling != 0.0)
         laplace_matrix_coefficient.reinit(n_cells, integrator.n_q_points);
 
+      std::unique_ptr<FEValues<dim>> fe_values;
+      if (lean_setup)
+        fe_values = std::make_unique<FEValues<dim>>(
+          *mapping,
+          matrix_free.get_dof_handler().get_fe(),
+          quadrature,
+          update_quadrature_points);
+      std::vector<Point<dim, VectorizedArray<Number>>> points(
+        integrator.n_q_points);
+
       for (unsigned int cell = 0; cell < n_cells; ++cell)
         {
-          integrator.reinit(cell);
-          for (const unsigned int q : integrator.quadrature_point_indices())
+          if (lean_setup)
+            {
+              // Unused lanes get the points of the first cell in the batch
+              unsigned int const n_filled =
+                matrix_free.n_active_entries_per_cell_batch(cell);
+              for (unsigned int v = 0; v < VectorizedArray<Number>::size(); ++v)
+                {
+                  fe_values->reinit(
+                    matrix_free.get_cell_iterator(cell, v < n_filled ? v : 0));
+                  for (const unsigned int q :
+                       fe_values->quadrature_point_indices())
+                    for (unsigned int d = 0; d < dim; ++d)
+                      points[q][d][v] = fe_values->quadrature_point(q)[d];
+                }
+            }
+          else
+            {
+              integrator.reinit(cell);
+              for (const unsigned int q : integrator.quadrature_point_indices())
+                points[q] = integrator.quadrature_point(q);
+            }
+
+          for (unsigned int q = 0; q < points.size(); ++q)
             {
               if (mass_matrix_scaling != 0.0)
                 mass_matrix_coefficient(cell, q) =
-                  coefficient_fun.value(integrator.quadrature_point(q));
+                  coefficient_fun.value(points[q]);
               if (laplace_matrix_scaling != 0.0)
                 laplace_matrix_coefficient(cell, q) =
-                  coefficient_fun.value(integrator.quadrature_point(q));
+                  coefficient_fun.value(points[q]);
             }
         }
       if (!mass_matrix_coefficient.empty())
         has_mass_coefficient = true;
       if (!laplace_matrix_coefficient.empty())
         has_laplace_coefficient = true;
+      if (float_geometry)
+        compute_float_geometry();
+    }
+
+    /** Re-evaluate a time-dependent coefficient at the time set in
+     * coefficient_fun. Only the coefficient tables and the diagonal are
+     * recomputed. Returns the L1 norm of the change of the coefficient
+     * relative to the L1 norm of the previous coefficient. Unlike a maximum
+     * norm, this does not flag a jump that only moves through a few cells.
+     */
+    Number
+    update_coefficient(const Coefficient<dim> &coefficient_fun)
+    {
+      auto const old_coefficient = laplace_matrix_scaling != 0.0 ?
+                                     laplace_matrix_coefficient :
+                                     mass_matrix_coefficient;
+      evaluate_coefficient(coefficient_fun);
+      compute_diagonal();
+
+      auto const &new_coefficient = laplace_matrix_scaling != 0.0 ?
+                                      laplace_matrix_coefficient :
+                                      mass_matrix_coefficient;
+      if (old_coefficient.empty())
+        return 0.0;
+
+      FECellIntegrator integrator(matrix_free);
+      Number           change = 0.0, norm = 0.0;
+      for (unsigned int cell = 0; cell < new_coefficient.size(0); ++cell)
+        {
+          integrator.reinit(cell);
+          unsigned int const n_lanes_filled =
+            matrix_free.n_active_entries_per_cell_batch(cell);
+          for (unsigned int q = 0; q < new_coefficient.size(1); ++q)
+            {
+              auto const JxW = integrator.JxW(q);
+              for (unsigned int v = 0; v < n_lanes_filled; ++v)
+                {
+                  Number const c_old = old_coefficient(cell, q)[v];
+                  Number const c_new = new_coefficient(cell, q)[v];
+                  change += JxW[v] * std::abs(c_new - c_old);
+                  norm += JxW[v] * std::abs(c_old);
+                }
+            }
+        }
+      MPI_Comm const comm = matrix_free.get_dof_handler().get_communicator();
+      change              = Utilities::MPI::sum(change, comm);
+      norm                = Utilities::MPI::sum(norm, comm);
+      return norm > 0.0 ? change / norm : change;
+    }
+
+    /** Store the geometry merged with the coefficient in single precision.
+     *
+     * Vectors and arithmetic stay in Number. Instead of the inverse Jacobian,
+     * JxW and the coefficient, the quadrature loop reads the symmetric tensor
+     * c J^{-1} J^{-T} JxW (dim*(dim+1)/2 floats) for the Laplace part and c JxW
+     * (one float) for the mass part. This reduces the data read per
+     * application on deformed meshes, where MatrixFree stores the Jacobian
+     * on every quadrature point. On Cartesian and affine cell batches
+     * MatrixFree stores a single Jacobian per batch, which is less than the
+     * tables would be, so these batches keep the standard quadrature loop
+     * and get no table entries.
+     */
+    void
+    set_float_geometry(bool const use_float_geometry)
+    {
+      float_geometry = use_float_geometry;
+      if (float_geometry)
+        compute_float_geometry();
+      else
+        {
+          float_geometry_index.clear();
+          mass_matrix_geometry.clear();
+          laplace_matrix_geometry.clear();
+        }
+      compute_diagonal();
     }
 
+    /** Largest polynomial degree with a precompiled cell kernel. Operators
+     * with higher degrees or a quadrature that does not have degree+1 points
+     * per direction use the kernel with run-time sizes.
+     */
+    static constexpr int max_kernel_degree = 6;
+
   private:
     using FECellIntegrator = FEEvaluation<dim, -1, 0, 1, Number>;
 
+    template <int fe_degree>
+    using FECellIntegratorDegree =
+      FEEvaluation<dim,
+                   fe_degree,
+                   fe_degree == -1 ? 0 : fe_degree + 1,
+                   1,
+                   Number>;
+
+    template <int fe_degree>
     void
-    compute_diagonal()
-    {
-      diagonal         = std::make_shared<DiagonalMatrix<VectorType>>();
-      diagonal_inverse = std::make_shared<DiagonalMatrix<VectorType>>();
-      VectorType &diagonal_inv_vector = diagonal_inverse->get_vector();
-      VectorType &diagonal_vector     = diagonal->get_vector();
-      initialize_dof_vector(diagonal_inv_vector);
-      initialize_dof_vector(diagonal_vector);
-      MatrixFreeTools::compute_diagonal(
-        matrix_free,
-        diagonal_vector,
-        &MatrixFreeOperator::do_cell_integral_local,
-        this);
-      diagonal_inv_vector = diagonal_vector;
-      auto constexpr tol  = std::sqrt(std::numeric_limits<Number>::epsilon());
-      for (auto &i : diagonal_inv_vector)
-        i = std::abs(i) > tol ? 1. / i : 1.;
+    vmult_dispatch(VectorType &dst, const VectorType &src) const
+    {
+      if constexpr (fe_degree > max_kernel_degree)
+        matrix_free.cell_loop(
+          &MatrixFreeOperator::template do_cell_integral_range<-1>,
+          this,
+          dst,
+          src,
+          true);
+      else if (kernel_degree == fe_degree)
+        matrix_free.cell_loop(
+          &MatrixFreeOperator::template do_cell_integral_range<fe_degree>,
+          this,
+          dst,
+          src,
+          true);
+      else
+        vmult_dispatch<fe_degree + 1>(dst, src);
+    }
+
+    static constexpr unsigned int n_lanes = VectorizedArray<Number>::size();
+    static constexpr unsigned int n_sym   = dim * (dim + 1) / 2;
+
+    static VectorizedArray<Number>
+    load_float(float const *data)
+    {
+      VectorizedArray<Number> result;
+      for (unsigned int v = 0; v < n_lanes; ++v)
+        result[v] = data[v];
+      return result;
     }
 
+    void
+    compute_float_geometry()
+    {
+      FECellIntegrator   integrator(matrix_free);
+      const unsigned int n_cells = matrix_free.n_cell_batches();
+      const unsigned int n_q     = integrator.n_q_points;
+
+      // Only batches with a Jacobian per quadrature point get table entries
+      float_geometry_index.assign(n_cells, numbers::invalid_unsigned_int);
+      unsigned int n_general_cells = 0;
+      for (unsigned int cell = 0; cell < n_cells; ++cell)
+        if (matrix_free.get_mapping_info().get_cell_type(cell) >
+            internal::MatrixFreeFunctions::affine)
+          float_geometry_index[cell] = n_general_cells++;
+
+      mass_matrix_geometry.clear();
+      laplace_matrix_geometry.clear();
+      if (mass_matrix_scaling != 0.0)
+        mass_matrix_geometry.resize_fast(n_general_cells * n_q * n_lanes);
+      if (laplace_matrix_scaling != 0.0)
+        laplace_matrix_geometry.resize_fast(n_general_cells * n_q * n_sym *
+                                            n_lanes);
+
+      for (unsigned int cell = 0; cell < n_cells; ++cell)
+        {
+          if (float_geometry_index[cell] == numbers::invalid_unsigned_int)
+            continue;
+          integrator.reinit(cell);
+          for (const unsigned int q : integrator.quadrature_point_indices())
+            {
+              std::size_t const offset =
+                static_cast<std::size_t>(float_geometry_index[cell]) * n_q + q;
+              if (mass_matrix_scaling != 0.0)
+                {
+                  VectorizedArray<Number> const c =
+                    integrator.JxW(q) * (has_mass_coefficient ?
+                                           mass_matrix_coefficient(cell, q) :
+                                           mass_matrix_scaling);
+                  for (unsigned int v = 0; v < n_lanes; ++v)
+                    mass_matrix_geometry[offset * n_lanes + v] = c[v];
+                }
+              if (laplace_matrix_scaling != 0.0)
+                {
+                  VectorizedArray<Number> const c =
+                    integrator.JxW(q) * (has_laplace_coefficient ?
+                                           laplace_matrix_coefficient(cell, q) :
+                                           laplace_matrix_scaling);
+                  auto const inv_jac = integrator.inverse_jacobian(q);
+                  float     *geometry =
+                    &laplace_matrix_geometry[offset * n_sym * n_lanes];
+                  for (unsigned int d = 0; d < dim; ++d)
+                    for (unsigned int e = d; e < dim; ++e)
+                      {
+                        VectorizedArray<Number> t =
+                          inv_jac[0][d] * inv_jac[0][e];
+                        for (unsigned int k = 1; k < dim; ++k)
+                          t += inv_jac[k][d] * inv_jac[k][e];
+                        t *= c;
+                        for (unsigned int v = 0; v < n_lanes; ++v, ++geometry)
+                          *geometry = t[v];
+                      }
+                }
+            }
+        }
+    }
+
+    // Quadrature loop with the merged single precision geometry. We work on the
+    // reference cell values and gradients directly and bypass the geometry
+    // stored in MatrixFree.
+    template <typename FEEvaluationType>
+    void
+    do_quadrature_float_geometry(FEEvaluationType &integrator) const
+    {
+      unsigned int const n_q = integrator.n_q_points;
+      std::size_t const  offset =
+        static_cast<std::size_t>(
+          float_geometry_index[integrator.get_current_cell_index()]) *
+        n_q;
+      if (mass_matrix_scaling != 0.0)
+        {
+          VectorizedArray<Number> *values = integrator.begin_values();
+          float const *geometry = &mass_matrix_geometry[offset * n_lanes];
+          for (unsigned int q = 0; q < n_q; ++q)
+            values[q] *= load_float(geometry + q * n_lanes);
+        }
+      if (laplace_matrix_scaling != 0.0)
+        {
+          VectorizedArray<Number> *gradients = integrator.begin_gradients();
+          for (unsigned int q = 0; q < n_q; ++q)
+            {
+              float const *geometry =
+                &laplace_matrix_geometry[(offset + q) * n_sym * n_lanes];
+              Tensor<1, dim, VectorizedArray<Number>> grad, res;
+              for (unsigned int d = 0; d < dim; ++d)
+                grad[d] = gradients[d * n_q + q];
+              unsigned int i = 0;
+              for (unsigned int d = 0; d < dim; ++d)
+                for (unsigned int e = d; e < dim; ++e, ++i)
+                  {
+                    VectorizedArray<Number> const t =
+                      load_float(geometry + i * n_lanes);
+                    res[d] += t * grad[e];
+                    if (e != d)
+                      res[e] += t * grad[d];
+                  }
+              for (unsigned int d = 0; d < dim; ++d)
+                gradients[d * n_q + q] = res[d];
+            }
+        }
+    }
+
+    void
+    compute_diagonal();
+
+    template <int fe_degree>
     void
     do_cell_integral_range(
       const MatrixFree<dim, Number>               &matrix_free,
@@ -491,7 +798,7 @@ namespace dealii
       const VectorType                            &src,
       const std::pair<unsigned int, unsigned int> &range) const
     {
-      FECellIntegrator integrator(matrix_free);
+      FECellIntegratorDegree<fe_degree> integrator(matrix_free);
 
       for (unsigned int cell = range.first; cell < range.second; ++cell)
         {
@@ -507,8 +814,9 @@ namespace dealii
         }
     }
 
+    template <typename FEEvaluationType>
     void
-    do_cell_integral_local(FECellIntegrator &integrator) const
+    do_cell_integral_local(FEEvaluationType &integrator) const
     {
       unsigned int const cell = integrator.get_current_cell_index();
       // evaluate
@@ -521,21 +829,25 @@ namespace dealii
         integrator.evaluate(EvaluationFlags::gradients);
 
       // quadrature
-      for (unsigned int q = 0; q < integrator.n_q_points; ++q)
-        {
-          if (mass_matrix_scaling != 0.0)
-            integrator.submit_value((has_mass_coefficient ?
-                                       mass_matrix_coefficient(cell, q) :
-                                       mass_matrix_scaling) *
-                                      integrator.get_value(q),
-                                    q);
-          if (laplace_matrix_scaling != 0.0)
-            integrator.submit_gradient((has_laplace_coefficient ?
-                                          laplace_matrix_coefficient(cell, q) :
-                                          laplace_matrix_scaling) *
-                                         integrator.get_gradient(q),
-                                       q);
-        }
+      if (float_geometry &&
+          float_geometry_index[cell] != numbers::invalid_unsigned_int)
+        do_quadrature_float_geometry(integrator);
+      else
+        for (unsigned int q = 0; q < integrator.n_q_points; ++q)
+          {
+            if (mass_matrix_scaling != 0.0)
+              integrator.submit_value((has_mass_coefficient ?
+                                         mass_matrix_coefficient(cell, q) :
+                                         mass_matrix_scaling) *
+                                        integrator.get_value(q),
+                                      q);
+            if (laplace_matrix_scaling != 0.0)
+              integrator.submit_gradient(
+                (has_laplace_coefficient ? laplace_matrix_coefficient(cell, q) :
+                                           laplace_matrix_scaling) *
+                  integrator.get_gradient(q),
+                q);
+          }
 
       // integrate
       if (mass_matrix_scaling != 0.0 && laplace_matrix_scaling != 0.0)
@@ -559,5 +871,194 @@ namespace dealii
     bool                              has_laplace_coefficient = false;
     Table<2, VectorizedArray<Number>> mass_matrix_coefficient;
     Table<2, VectorizedArray<Number>> laplace_matrix_coefficient;
+
+    int                              kernel_degree = -1;
+    bool                             lean_setup;
+    SmartPointer<const Mapping<dim>> mapping;
+    Quadrature<dim>                  quadrature;
+
+    bool                      float_geometry = false;
+    std::vector<unsigned int> float_geometry_index;
+    AlignedVector<float>      mass_matrix_geometry;
+    AlignedVector<float>      laplace_matrix_geometry;
   };
+
+  // The members below instantiate the cell kernels. They are defined outside
+  // the class, so that the extern template declarations at the end of this
+  // file suppress them and only lod compiles the kernels.
+  template <int dim, typename Number>
+  void
+  MatrixFreeOperator<dim, Number>::vmult(VectorType       &dst,
+                                         const VectorType &src) const
+  {
+    CommunicationScope scope(CommunicationKernel::matvec);
+    RegionMarker       marker("cell_loop");
+    vmult_dispatch<1>(dst, src);
+  }
+
+  template <int dim, typename Number>
+  void
+  MatrixFreeOperator<dim, Number>::compute_system_matrix(
+    SparseMatrixType &sparse_matrix) const
+  {
+    MatrixFreeTools::compute_matrix(
+      matrix_free,
+      matrix_free.get_affine_constraints(),
+      sparse_matrix,
+      &MatrixFreeOperator::template do_cell_integral_local<FECellIntegrator>,
+      this);
+  }
+
+  template <int dim, typename Number>
+  void
+  MatrixFreeOperator<dim, Number>::compute_diagonal()
+  {
+    diagonal         = std::make_shared<DiagonalMatrix<VectorType>>();
+    diagonal_inverse = std::make_shared<DiagonalMatrix<VectorType>>();
+    VectorType &diagonal_inv_vector = diagonal_inverse->get_vector();
+    VectorType &diagonal_vector     = diagonal->get_vector();
+    initialize_dof_vector(diagonal_inv_vector);
+    initialize_dof_vector(diagonal_vector);
+    MatrixFreeTools::compute_diagonal(
+      matrix_free,
+      diagonal_vector,
+      &MatrixFreeOperator::template do_cell_integral_local<FECellIntegrator>,
+      this);
+    diagonal_inv_vector = diagonal_vector;
+    auto constexpr tol  = std::sqrt(std::numeric_limits<Number>::epsilon());
+    for (auto &i : diagonal_inv_vector)
+      i = std::abs(i) > tol ? 1. / i : 1.;
+  }
+
+  /** Cubic reaction term g(u) = sigma u^3 for nonlinear variants of the heat
+   * and the wave equation. It works on the matrix-free data of the spatial
+   * operators and provides the residual contribution (g(u), v), the action of
+   * the linearization (g'(u_0) w, v) and the mean of g'(u_0) over the domain.
+   */
+  template <int dim, typename Number>
+  class CubicReactionOperator
+  {
+  public:
+    using VectorType = VectorT<Number>;
+
+    CubicReactionOperator(MatrixFree<dim, Number> const &matrix_free,
+                          Number const                   sigma)
+      : matrix_free(matrix_free)
+      , sigma(sigma)
+    {}
+
+    void
+    evaluate(VectorType &dst, VectorType const &u) const
+    {
+      matrix_free.template cell_loop<VectorType, VectorType>(
+        [&](MatrixFree<dim, Number> const               &data,
+            VectorType                                  &dst,
+            VectorType const                            &src,
+            std::pair<unsigned int, unsigned int> const &range) {
+          FECellIntegrator integrator(data);
+          for (unsigned int cell = range.first; cell < range.second; ++cell)
+            {
+              integrator.reinit(cell);
+              integrator.gather_evaluate(src, EvaluationFlags::values);
+              for (unsigned int q = 0; q < integrator.n_q_points; ++q)
+                {
+                  auto const u_q = integrator.get_value(q);
+                  integrator.submit_value(sigma * u_q * u_q * u_q, q);
+                }
+              integrator.integrate_scatter(EvaluationFlags::values, dst);
+            }
+        },
+        dst,
+        u,
+        true);
+    }
+
+    void
+    vmult_linearized(VectorType       &dst,
+                     VectorType const &u_0,
+                     VectorType const &src) const
+    {
+      u_0.update_ghost_values();
+      matrix_free.template cell_loop<VectorType, VectorType>(
+        [&](MatrixFree<dim, Number> const               &data,
+            VectorType                                  &dst,
+            VectorType const                            &src,
+            std::pair<unsigned int, unsigned int> const &range) {
+          Number const     three = 3.0;
+          FECellIntegrator integrator(data);
+          FECellIntegrator linearization(data);
+          for (unsigned int cell = range.first; cell < range.second; ++cell)
+            {
+              integrator.reinit(cell);
+              linearization.reinit(cell);
+              integrator.gather_evaluate(src, EvaluationFlags::values);
+              linearization.gather_evaluate(u_0, EvaluationFlags::values);
+              for (unsigned int q = 0; q < integrator.n_q_points; ++q)
+                {
+                  auto const u_q = linearization.get_value(q);
+                  integrator.submit_value(
+                    three * sigma * u_q * u_q * integrator.get_value(q), q);
+                }
+              integrator.integrate_scatter(EvaluationFlags::values, dst);
+            }
+        },
+        dst,
+        src,
+        true);
+      u_0.zero_out_ghost_values();
+    }
+
+    /** Mean of g'(u_0) = 3 sigma u_0^2 over the domain
+     */
+    Number
+    mean_derivative(VectorType const &u_0) const
+    {
+      u_0.update_ghost_values();
+      FECellIntegrator integrator(matrix_free);
+      double           integral = 0.0, volume = 0.0;
+      for (unsigned int cell = 0; cell < matrix_free.n_cell_batches(); ++cell)
+        {
+          integrator.reinit(cell);
+          integrator.gather_evaluate(u_0, EvaluationFlags::values);
+          unsigned int const n_filled =
+            matrix_free.n_active_entries_per_cell_batch(cell);
+          for (unsigned int q = 0; q < integrator.n_q_points; ++q)
+            {
+              auto const u_q = integrator.get_value(q);
+              auto const JxW = integrator.JxW(q);
+              for (unsigned int v = 0; v < n_filled; ++v)
+                {
+                  integral += 3.0 * sigma * u_q[v] * u_q[v] * JxW[v];
+                  volume += JxW[v];
+                }
+            }
+        }
+      u_0.zero_out_ghost_values();
+      MPI_Comm const comm = matrix_free.get_dof_handler().get_communicator();
+      return Utilities::MPI::sum(integral, comm) /
+             Utilities::MPI::sum(volume, comm);
+    }
+
+  private:
+    using FECellIntegrator = FEEvaluation<dim, -1, 0, 1, Number>;
+
+    MatrixFree<dim, Number> const &matrix_free;
+    Number                         sigma;
+  };
+
+  template <int dim, typename Number>
+  using MatrixFreeSystemMatrix =
+    SystemMatrix<Number, MatrixFreeOperator<dim, Number>>;
+
+#ifdef LOD_PRECOMPILED_KERNELS
+  // Instantiated in source/operators.cc
+  extern template class MatrixFreeOperator<2, double>;
+  extern template class MatrixFreeOperator<2, float>;
+  extern template class MatrixFreeOperator<3, double>;
+  extern template class MatrixFreeOperator<3, float>;
+  extern template class SystemMatrix<double, MatrixFreeOperator<2, double>>;
+  extern template class SystemMatrix<float, MatrixFreeOperator<2, float>>;
+  extern template class SystemMatrix<double, MatrixFreeOperator<3, double>>;
+  extern template class SystemMatrix<float, MatrixFreeOperator<3, float>>;
+#endif
 } // namespace dealii
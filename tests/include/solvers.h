@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#pragma once
+
+#include <deal.II/base/logstream.h>
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector.h>
+
+#include "types.h"
+
+namespace dealii
+{
+  /** Restarted flexible GMRES with the Krylov basis stored in NumberBasis
+   *
+   * The basis vectors v_j and the preconditioned vectors z_j are kept in
+   * NumberBasis (usually float), which halves the dominant memory and the
+   * bandwidth of the orthogonalization. All arithmetic is done in Number:
+   * the orthogonalization uses classical Gram-Schmidt with one
+   * reorthogonalization, each pass with a single fused reduction, and the
+   * residual is recomputed with the operator in Number at every restart and
+   * before convergence is accepted. The rounding of the basis thus only
+   * affects the convergence rate, not the attainable accuracy.
+   */
+  template <typename Number, typename NumberBasis>
+  class SolverFGMRESReducedBasis
+  {
+  public:
+    using BlockVectorType = BlockVectorT<Number>;
+    using BasisVectorType = BlockVectorT<NumberBasis>;
+
+    SolverFGMRESReducedBasis(SolverControl     &control,
+                             unsigned int const max_basis_size = 30)
+      : control(control)
+      , max_basis_size(max_basis_size)
+    {}
+
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(MatrixType const         &A,
+          BlockVectorType          &x,
+          BlockVectorType const    &b,
+          PreconditionerType const &preconditioner)
+    {
+      unsigned int const m = max_basis_size;
+      BlockVectorType    r, w;
+      r.reinit(b, true);
+      w.reinit(b, true);
+      std::vector<BasisVectorType> V(m + 1), Z(m);
+
+      FullMatrix<double>  H(m + 1, m);
+      Vector<double>      g(m + 1), cs(m), sn(m);
+      std::vector<double> h(m + 1);
+
+      unsigned int         step  = 0;
+      SolverControl::State state = SolverControl::iterate;
+      while (true)
+        {
+          // true residual in Number
+          A.vmult(r, x);
+          r.sadd(-1.0, 1.0, b);
+          double const beta = r.l2_norm();
+          state             = control.check(step, beta);
+          if (state != SolverControl::iterate)
+            break;
+
+          reinit_basis_vector(V[0], b);
+          assign(V[0], r, 1.0 / beta);
+          g    = 0.0;
+          g[0] = beta;
+
+          unsigned int k = 0;
+          for (; k < m && state == SolverControl::iterate; ++k)
+            {
+              // z_k = P v_k, stored in NumberBasis. The operator is applied
+              // to the rounded z_k, so that the update of x is consistent.
+              reinit_basis_vector(Z[k], b);
+              assign(w, V[k]);
+              preconditioner.vmult(r, w);
+              assign(Z[k], r);
+              assign(r, Z[k]);
+              A.vmult(w, r);
+
+              for (unsigned int pass = 0; pass < 2; ++pass)
+                {
+                  project(h, V, k + 1, w);
+                  for (unsigned int i = 0; i <= k; ++i)
+                    {
+                      H(i, k) += h[i];
+                      add(w, -h[i], V[i]);
+                    }
+                }
+              H(k + 1, k) = w.l2_norm();
+              reinit_basis_vector(V[k + 1], b);
+              if (H(k + 1, k) > 0.0)
+                assign(V[k + 1], w, 1.0 / H(k + 1, k));
+
+              // Givens rotations
+              for (unsigned int i = 0; i < k; ++i)
+                {
+                  double const tmp = cs[i] * H(i, k) + sn[i] * H(i + 1, k);
+                  H(i + 1, k)      = -sn[i] * H(i, k) + cs[i] * H(i + 1, k);
+                  H(i, k)          = tmp;
+                }
+              double const rho = std::hypot(H(k, k), H(k + 1, k));
+              cs[k]            = H(k, k) / rho;
+              sn[k]            = H(k + 1, k) / rho;
+              H(k, k)          = rho;
+              H(k + 1, k)      = 0.0;
+              g[k + 1]         = -sn[k] * g[k];
+              g[k]             = cs[k] * g[k];
+
+              state = control.check(++step, std::abs(g[k + 1]));
+            }
+
+          // x += Z y with H y = g
+          for (int i = static_cast<int>(k) - 1; i >= 0; --i)
+            {
+              for (unsigned int j = i + 1; j < k; ++j)
+                g[i] -= H(i, j) * g[j];
+              g[i] /= H(i, i);
+            }
+          for (unsigned int i = 0; i < k; ++i)
+            add(x, g[i], Z[i]);
+          H = 0.0;
+
+          if (state == SolverControl::failure)
+            break;
+        }
+
+      AssertThrow(state == SolverControl::success,
+                  SolverControl::NoConvergence(control.last_step(),
+                                               control.last_value()));
+    }
+
+  private:
+    // The basis is allocated on first use, like in SolverFGMRES
+    static void
+    reinit_basis_vector(BasisVectorType &v, BlockVectorType const &layout)
+    {
+      if (v.n_blocks() == layout.n_blocks())
+        return;
+      v.reinit(layout.n_blocks());
+      for (unsigned int b = 0; b < layout.n_blocks(); ++b)
+        v.block(b).reinit(layout.block(b).get_partitioner());
+      v.collect_sizes();
+    }
+
+    // dst = scaling * src, converting the precision
+    template <typename Number1, typename Number2>
+    static void
+    assign(BlockVectorT<Number1>       &dst,
+           BlockVectorT<Number2> const &src,
+           double const                 scaling = 1.0)
+    {
+      for (unsigned int b = 0; b < src.n_blocks(); ++b)
+        for (unsigned int i = 0; i < src.block(b).locally_owned_size(); ++i)
+          dst.block(b).local_element(i) =
+            scaling * src.block(b).local_element(i);
+    }
+
+    // dst += a * src with src in NumberBasis
+    static void
+    add(BlockVectorType &dst, double const a, BasisVectorType const &src)
+    {
+      for (unsigned int b = 0; b < src.n_blocks(); ++b)
+        for (unsigned int i = 0; i < src.block(b).locally_owned_size(); ++i)
+          dst.block(b).local_element(i) +=
+            a * static_cast<double>(src.block(b).local_element(i));
+    }
+
+    // h_i = (v_i, w) for i < n, with one reduction for all of them
+    static void
+    project(std::vector<double>                &h,
+            std::vector<BasisVectorType> const &V,
+            unsigned int const                  n,
+            BlockVectorType const              &w)
+    {
+      std::fill(h.begin(), h.end(), 0.0);
+      for (unsigned int b = 0; b < w.n_blocks(); ++b)
+        for (unsigned int i = 0; i < n; ++i)
+          {
+            double sum = 0.0;
+            for (unsigned int l = 0; l < w.block(b).locally_owned_size(); ++l)
+              sum += static_cast<double>(V[i].block(b).local_element(l)) *
+                     w.block(b).local_element(l);
+            h[i] += sum;
+          }
+      Utilities::MPI::sum(ArrayView<const double>(h.data(), n),
+                          w.block(0).get_mpi_communicator(),
+                          ArrayView<double>(h.data(), n));
+    }
+
+    SolverControl     &control;
+    unsigned int const max_basis_size;
+  };
+
+  /** Preconditioned Richardson iteration x <- x + P (b - A x), the
+   * stationary multigrid solver. It needs two vectors and one reduction per
+   * iteration.
+   *
+   * solve() returns true once the tolerances of control are reached. It
+   * returns false when an iteration reduces the residual by less than
+   * stall_rate, or when the iteration limit is reached. A Krylov method can
+   * then continue from x with fallback_control(): its target is the
+   * reduction of control relative to the initial residual, and the
+   * Richardson iterations count towards the iteration limit.
+   */
+  template <typename VectorType>
+  class SolverRichardsonStall
+  {
+  public:
+    SolverRichardsonStall(ReductionControl &control, double const stall_rate)
+      : control(control)
+      , stall_rate(stall_rate)
+    {}
+
+    template <typename MatrixType, typename PreconditionerType>
+    bool
+    solve(MatrixType const         &A,
+          VectorType               &x,
+          VectorType const         &b,
+          PreconditionerType const &preconditioner)
+    {
+      VectorType r, d;
+      r.reinit(b, true);
+      d.reinit(b, true);
+      A.vmult(r, x);
+      r.sadd(-1.0, 1.0, b);
+      double r_norm = r.l2_norm();
+      r0_norm       = r_norm;
+      n_steps       = 0;
+
+      SolverControl::State state = control.check(0, r_norm);
+      while (state == SolverControl::iterate)
+        {
+          preconditioner.vmult(d, r);
+          x += d;
+          A.vmult(r, x);
+          r.sadd(-1.0, 1.0, b);
+          double const r_norm_new = r.l2_norm();
+          state                   = control.check(++n_steps, r_norm_new);
+          if (state == SolverControl::iterate &&
+              r_norm_new > stall_rate * r_norm)
+            {
+              deallog << "Richardson stalled after " << n_steps
+                      << " iterations (rate " << r_norm_new / r_norm
+                      << "), switching to FGMRES" << std::endl;
+              return false;
+            }
+          r_norm = r_norm_new;
+        }
+      return state == SolverControl::success;
+    }
+
+    unsigned int
+    last_step() const
+    {
+      return n_steps;
+    }
+
+    SolverControl
+    fallback_control() const
+    {
+      return SolverControl(control.max_steps() -
+                             std::min(control.max_steps(), n_steps),
+                           std::max(control.tolerance(),
+                                    control.reduction() * r0_norm),
+                           false,
+                           true);
+    }
+
+  private:
+    ReductionControl &control;
+    double const      stall_rate;
+    double            r0_norm = 0.0;
+    unsigned int      n_steps = 0;
+  };
+} // namespace dealii
@@ -3,27 +3,53 @@
 
 #pragma once
 
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/solver_bicgstab.h>
 #include <deal.II/lac/solver_control.h>
 #include <deal.II/lac/solver_gmres.h>
+#include <deal.II/lac/solver_idr.h>
 
 #include "gmg.h"
 #include "operators.h"
+#include "solvers.h"
 #include "types.h"
 
+#include <optional>
+
 namespace dealii
 {
+  /** Geometric multigrid preconditioner on the matrix-free space-time level
+   * operators
+   */
+  template <int dim, typename Number>
+  using MatrixFreeGMG = GMG<dim, Number, MatrixFreeSystemMatrix<dim, Number>>;
+
   /** Time stepping by DG and CGP variational time discretizations
    *
-   * This time integrator is suited for linear problems. For nonlinear problems
-   * we would need a few extensions in order to integrate nonlinear terms
-   * accurately.
+   * Linear problems are solved with one preconditioned FGMRES solve per slab.
+   * Alternatively, set_slab_solver() selects a stationary Richardson
+   * iteration with the multigrid V-cycle, which stores no Krylov basis and
+   * falls back to FGMRES once its convergence stalls, or one of the short
+   * recurrence Krylov methods IDR(s) and BiCGStab, whose memory does not
+   * grow with the number of iterations. The FGMRES basis can be stored in
+   * float, see SolverFGMRESReducedBasis. With iterative refinement the
+   * correction is computed entirely in the precision of the preconditioner
+   * by FGMRES on the finest multigrid level operator, set by
+   * set_inner_matrix(), and only the residual is computed in Number.
+   * Optionally, linear slab solves start from a full multigrid cycle.
+   * With a reaction term set by set_reaction() the slabs are solved by an
+   * inexact Newton method. The Jacobian is applied matrix-free and the
+   * preconditioner is only rebuilt once the linear convergence degrades, so
+   * the multigrid hierarchy is reused over Newton steps and slabs.
    */
   template <int dim, typename Number, typename Preconditioner>
   class TimeIntegrator
   {
   public:
-    using VectorType      = VectorT<Number>;
-    using BlockVectorType = BlockVectorT<Number>;
+    using VectorType           = VectorT<Number>;
+    using BlockVectorType      = BlockVectorT<Number>;
+    using InnerNumber          = typename Preconditioner::value_type;
+    using InnerBlockVectorType = BlockVectorT<InnerNumber>;
 
     TimeIntegrator(
       TimeStepType              type_,
@@ -43,6 +69,8 @@ namespace dealii
       , Gamma(Gamma_)
       , solver_control(200, 1.e-12, gmres_tolerance_, false, true)
       , solver(solver_control)
+      , newton_control(200, 1.e-12, 1.e-4, false, true)
+      , newton_solver(newton_control)
       , preconditioner(preconditioner_)
       , matrix(matrix_)
       , rhs_matrix(rhs_matrix_)
@@ -86,16 +114,392 @@ namespace dealii
           }
     }
 
+    /** Add the reaction term g(u) and switch to the Newton-Krylov solver.
+     * rebuild_preconditioner is called with the mean of g'(u) whenever the
+     * lagged preconditioner has to be updated.
+     */
+    void
+    set_reaction(
+      std::shared_ptr<const CubicReactionOperator<dim, Number>> reaction_,
+      NewtonAdditionalData const                               &newton_data_,
+      std::function<void(Number const)> rebuild_preconditioner_)
+    {
+      reaction               = reaction_;
+      newton_data            = newton_data_;
+      rebuild_preconditioner = rebuild_preconditioner_;
+      newton_control.set_reduction(newton_data.linear_reltol);
+    }
+
+    /** Provide initial guesses for the slabs instead of the extrapolation.
+     * The function is called with the slab vector and the start time of the
+     * slab and returns false if it has no guess for this slab.
+     */
+    void
+    set_initial_guess(
+      std::function<bool(BlockVectorType &, double const)> initial_guess_)
+    {
+      initial_guess = initial_guess_;
+    }
+
+    void
+    set_slab_solver(SlabSolverAdditionalData const &slab_solver_data_)
+    {
+      slab_solver_data = slab_solver_data_;
+    }
+
+    void
+    set_inner_matrix(
+      SystemMatrix<InnerNumber, MatrixFreeOperator<dim, InnerNumber>> const
+        &inner_matrix_)
+    {
+      inner_matrix = &inner_matrix_;
+    }
+
     unsigned int
     last_step() const
     {
-      return solver_control.last_step();
+      return n_linear_iterations;
+    }
+
+    /** Memory the slab solver allocates in addition to the solution and
+     * the right-hand side, in block vectors of type BlockVectorType
+     */
+    double
+    n_solver_vectors() const
+    {
+      unsigned int const max_basis_size =
+        typename SolverFGMRES<BlockVectorType>::AdditionalData().max_basis_size;
+      double const inner_size =
+        static_cast<double>(sizeof(InnerNumber)) / sizeof(Number);
+      double const n_fgmres_vectors =
+        slab_solver_data.float_basis ?
+          (2.0 * max_basis_size + 1) * sizeof(float) / sizeof(Number) + 2 :
+          2 * max_basis_size + 2;
+      // Richardson needs r and d. They are released before the FGMRES
+      // fallback allocates its basis, which is the worst case.
+      if (slab_solver_data.type == SlabSolverType::richardson)
+        return std::max(2.0, n_fgmres_vectors);
+      else if (slab_solver_data.type == SlabSolverType::refinement)
+        return 1 + (2 * max_basis_size + 4) * inner_size;
+      // The counts below are the vectors SolverIDR and SolverBicgstab of
+      // deal.II allocate: r, v, uhat, vhat and ghat and the s vectors of
+      // each of G, U and Q for IDR(s), and r, rbar, p, y, z, t and v for
+      // BiCGStab.
+      else if (slab_solver_data.type == SlabSolverType::idr)
+        return 5 + 3 * slab_solver_data.idr_s;
+      else if (slab_solver_data.type == SlabSolverType::bicgstab)
+        return 7;
+      return n_fgmres_vectors;
     }
 
   protected:
     void
-    extrapolate(BlockVectorType &x, VectorType const &prev_x) const
+    solve_system(BlockVectorType       &x,
+                 BlockVectorType const &rhs,
+                 VectorType const      &prev_x) const
+    {
+      CommunicationScope scope(CommunicationKernel::krylov);
+      n_linear_iterations = 0;
+      if (!reaction && slab_solver_data.fmg_start)
+        {
+          if (has_initial_guess)
+            {
+              // Full multigrid for the correction of the initial guess
+              BlockVectorType r, d;
+              r.reinit(rhs, true);
+              d.reinit(rhs, true);
+              matrix.vmult(r, x);
+              r.sadd(-1.0, 1.0, rhs);
+              preconditioner.fmg(d, r);
+              x += d;
+            }
+          else
+            preconditioner.fmg(x, rhs);
+        }
+      if (!reaction && slab_solver_data.type == SlabSolverType::refinement)
+        {
+          n_linear_iterations = solve_refinement(x, rhs);
+          return;
+        }
+      if (!reaction)
+        {
+          n_linear_iterations =
+            solve_linear(solver_control, solver, matrix, x, rhs);
+          return;
+        }
+
+      BlockVectorType residual, dx;
+      residual.reinit(rhs);
+      dx.reinit(rhs);
+      double residual_0 = 0.0;
+      for (unsigned int k = 0;; ++k)
+        {
+          // residual = rhs - A x - N(x)
+          matrix.vmult(residual, x);
+          add_nodal_term(residual, [&](VectorType &tmp, unsigned int const b) {
+            reaction->evaluate(tmp,
+                               b == numbers::invalid_unsigned_int ?
+                                 prev_x :
+                                 x.block(b));
+          });
+          residual.sadd(-1.0, 1.0, rhs);
+
+          double const residual_norm = residual.l2_norm();
+          if (k == 0)
+            residual_0 = residual_norm;
+          deallog << "Newton step " << k << " residual " << residual_norm
+                  << std::endl;
+          if (residual_norm <= newton_data.abstol ||
+              residual_norm <= newton_data.reltol * residual_0)
+            break;
+          AssertThrow(k < newton_data.max_iterations,
+                      ExcMessage("Newton solver did not converge"));
+
+          Jacobian const jacobian(*this, x);
+          dx = 0.0;
+          n_linear_iterations +=
+            solve_linear(newton_control, newton_solver, jacobian, dx, residual);
+          x += dx;
+
+          update_preconditioner(x);
+        }
+    }
+
+    /** Solve A x = b with the selected slab solver and return the number
+     * of iterations.
+     *
+     * The Richardson iteration x += P(b - A x) only needs two additional
+     * block vectors and one reduction per iteration for the residual check.
+     * It stops at the tolerances of control. If an iteration reduces the
+     * residual by less than the stall rate, FGMRES continues from the
+     * current iterate with its own control: the target is the reduction of
+     * control relative to the initial residual, and the Richardson
+     * iterations count towards the iteration limit.
+     */
+    template <typename MatrixType>
+    unsigned int
+    solve_linear(ReductionControl              &control,
+                 SolverFGMRES<BlockVectorType> &fgmres,
+                 MatrixType const              &A,
+                 BlockVectorType               &x,
+                 BlockVectorType const         &b) const
+    {
+      unsigned int                 n_richardson = 0;
+      std::optional<SolverControl> fallback_control;
+      if (slab_solver_data.type == SlabSolverType::richardson)
+        {
+          SolverRichardsonStall<BlockVectorType> richardson(
+            control, slab_solver_data.stall_rate);
+          bool const converged = richardson.solve(A, x, b, preconditioner);
+          n_richardson         = richardson.last_step();
+          if (converged)
+            return n_richardson;
+          fallback_control.emplace(richardson.fallback_control());
+        }
+
+      SolverControl &krylov_control =
+        fallback_control ? *fallback_control : control;
+      try
+        {
+          if (slab_solver_data.type == SlabSolverType::idr)
+            {
+              SolverIDR<BlockVectorType> idr(
+                krylov_control,
+                typename SolverIDR<BlockVectorType>::AdditionalData(
+                  slab_solver_data.idr_s));
+              idr.solve(A, x, b, preconditioner);
+            }
+          else if (slab_solver_data.type == SlabSolverType::bicgstab)
+            {
+              SolverBicgstab<BlockVectorType> bicgstab(krylov_control);
+              bicgstab.solve(A, x, b, preconditioner);
+            }
+          else if (slab_solver_data.float_basis)
+            {
+              SolverFGMRESReducedBasis<Number, float> fgmres_float(
+                krylov_control);
+              fgmres_float.solve(A, x, b, preconditioner);
+            }
+          else if (fallback_control)
+            {
+              SolverFGMRES<BlockVectorType> fgmres_fallback(*fallback_control);
+              fgmres_fallback.solve(A, x, b, preconditioner);
+            }
+          else
+            fgmres.solve(A, x, b, preconditioner);
+        }
+      catch (const SolverControl::NoConvergence &e)
+        {
+          AssertThrow(false, ExcMessage(e.what()));
+        }
+      return n_richardson + krylov_control.last_step();
+    }
+
+    /** Mixed-precision iterative refinement: the residual is computed with
+     * the operator in Number, the correction is solved to the inner tolerance
+     * by FGMRES in InnerNumber, with vectors, Krylov basis and multigrid all
+     * in InnerNumber. Returns the total number of inner iterations.
+     */
+    unsigned int
+    solve_refinement(BlockVectorType &x, BlockVectorType const &b) const
+    {
+      Assert(inner_matrix != nullptr, ExcNotInitialized());
+      BlockVectorType      r;
+      InnerBlockVectorType r_inner(x.n_blocks()), d_inner(x.n_blocks());
+      r.reinit(b, true);
+      for (unsigned int i = 0; i < x.n_blocks(); ++i)
+        {
+          inner_matrix->initialize_dof_vector(r_inner.block(i));
+          inner_matrix->initialize_dof_vector(d_inner.block(i));
+        }
+      r_inner.collect_sizes();
+      d_inner.collect_sizes();
+
+      ReductionControl inner_control(
+        solver_control.max_steps(), 0.0, slab_solver_data.inner_reltol);
+      SolverFGMRES<InnerBlockVectorType> inner_solver(inner_control);
+
+      unsigned int n_inner = 0;
+      matrix.vmult(r, x);
+      r.sadd(-1.0, 1.0, b);
+      SolverControl::State state = solver_control.check(0, r.l2_norm());
+      for (unsigned int k = 1; state == SolverControl::iterate; ++k)
+        {
+          r_inner.copy_locally_owned_data_from(r);
+          d_inner = 0.0;
+          try
+            {
+              inner_solver.solve(*inner_matrix,
+                                 d_inner,
+                                 r_inner,
+                                 preconditioner);
+            }
+          catch (const SolverControl::NoConvergence &)
+            {
+              // the refinement only needs a contraction
+            }
+          n_inner += inner_control.last_step();
+
+          r.copy_locally_owned_data_from(d_inner);
+          x += r;
+          matrix.vmult(r, x);
+          r.sadd(-1.0, 1.0, b);
+          state = solver_control.check(k, r.l2_norm());
+        }
+      AssertThrow(state == SolverControl::success,
+                  ExcMessage("Iterative refinement did not converge"));
+      return n_inner;
+    }
+
+    /** Action of the Jacobian A + N'(x) of the nonlinear slab problem
+     */
+    class Jacobian
+    {
+    public:
+      Jacobian(TimeIntegrator const &integrator, BlockVectorType const &x)
+        : integrator(integrator)
+        , x(x)
+      {}
+
+      void
+      vmult(BlockVectorType &dst, BlockVectorType const &src) const
+      {
+        integrator.matrix.vmult(dst, src);
+        integrator.add_nodal_term(
+          dst, [&](VectorType &tmp, unsigned int const b) {
+            // the initial value of the slab is fixed
+            if (b == numbers::invalid_unsigned_int)
+              tmp = 0.0;
+            else
+              integrator.reaction->vmult_linearized(tmp,
+                                                    x.block(b),
+                                                    src.block(b));
+          });
+      }
+
+    private:
+      TimeIntegrator const  &integrator;
+      BlockVectorType const &x;
+    };
+
+    /** Add the time integral of a spatial term evaluated at the temporal
+     * nodes, using the same nodal quadrature as assemble_force(). The term is
+     * called with the block holding the node value, or with
+     * numbers::invalid_unsigned_int for the initial value of the slab.
+     */
+    template <typename NodalTerm>
+    void
+    add_nodal_term(BlockVectorType &dst, NodalTerm const &term) const
+    {
+      VectorType tmp;
+      matrix.initialize_dof_vector(tmp);
+
+      for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+        for (unsigned int j = 0; j < quad_time.size(); ++j)
+          {
+            unsigned int const offset = it * Alpha.m();
+            if (type == TimeStepType::DG)
+              {
+                term(tmp, j + offset);
+                dst.block(j + offset).add(Alpha(j, j), tmp);
+              }
+            else if (j == 0)
+              {
+                term(tmp,
+                     it == 0 ? numbers::invalid_unsigned_int : offset - 1);
+                for (unsigned int i = 0; i < Gamma.m(); ++i)
+                  dst.block(i + offset).add(-Gamma(i, 0), tmp);
+              }
+            else
+              {
+                term(tmp, j - 1 + offset);
+                dst.block(j - 1 + offset).add(Alpha(j - 1, j - 1), tmp);
+              }
+          }
+    }
+
+    // Rebuild the lagged preconditioner once the linear solves need more than
+    // rebuild_factor times the iterations of the first solve after the last
+    // rebuild. The iteration count scales with 1/|log(rate)|.
+    void
+    update_preconditioner(BlockVectorType const &x) const
+    {
+      if (newton_control.last_step() == 0 || !rebuild_preconditioner)
+        return;
+
+      double const rate =
+        std::max(std::pow(newton_control.last_value() /
+                            newton_control.initial_value(),
+                          1.0 / newton_control.last_step()),
+                 1e-12);
+      if (reference_rate < 0.0)
+        reference_rate = rate;
+      else if (std::log(rate) * newton_data.rebuild_factor >
+               std::log(reference_rate))
+        {
+          Number mean_derivative = 0.0;
+          for (unsigned int b = 0; b < x.n_blocks(); ++b)
+            mean_derivative += reaction->mean_derivative(x.block(b));
+          mean_derivative /= x.n_blocks();
+
+          deallog << "Rebuild preconditioner: rate " << rate << " reference "
+                  << reference_rate << " mean g'(u) " << mean_derivative
+                  << std::endl;
+          rebuild_preconditioner(mean_derivative);
+          reference_rate = -1.0;
+        }
+    }
+
+    // Without a guess from set_initial_guess(), the full multigrid start
+    // overwrites x, so there is nothing to extrapolate
+    void
+    extrapolate(BlockVectorType  &x,
+                VectorType const &prev_x,
+                double const      time) const
     {
+      has_initial_guess = initial_guess && initial_guess(x, time);
+      if (has_initial_guess || (!reaction && slab_solver_data.fmg_start))
+        return;
       for (unsigned int j = 0; j < x.n_blocks(); ++j)
         if (do_extrapolate)
           x.block(j) = prev_x;
@@ -111,12 +515,26 @@ namespace dealii
 
     mutable ReductionControl                                     solver_control;
     mutable SolverFGMRES<BlockVectorType>                        solver;
+    mutable ReductionControl                                     newton_control;
+    mutable SolverFGMRES<BlockVectorType>                        newton_solver;
     Preconditioner const                                        &preconditioner;
     SystemMatrix<Number, MatrixFreeOperator<dim, Number>> const &matrix;
     SystemMatrix<Number, MatrixFreeOperator<dim, Number>> const &rhs_matrix;
     std::function<void(const double, VectorType &)> integrate_rhs_function;
     unsigned int                                    n_timesteps_at_once;
     bool                                            do_extrapolate;
+
+    std::function<bool(BlockVectorType &, double const)> initial_guess;
+    SlabSolverAdditionalData                             slab_solver_data;
+    SystemMatrix<InnerNumber, MatrixFreeOperator<dim, InnerNumber>> const
+      *inner_matrix = nullptr;
+
+    std::shared_ptr<const CubicReactionOperator<dim, Number>> reaction;
+    NewtonAdditionalData                                      newton_data;
+    std::function<void(Number const)> rebuild_preconditioner;
+    mutable unsigned int              n_linear_iterations = 0;
+    mutable double                    reference_rate      = -1.0;
+    mutable bool                      has_initial_guess   = false;
   };
 
 
@@ -168,15 +586,8 @@ namespace dealii
 
       this->assemble_force(rhs, time, time_step);
 
-      this->extrapolate(x, prev_x);
-      try
-        {
-          this->solver.solve(this->matrix, x, rhs, this->preconditioner);
-        }
-      catch (const SolverControl::NoConvergence &e)
-        {
-          AssertThrow(false, ExcMessage(e.what()));
-        }
+      this->extrapolate(x, prev_x, time);
+      this->solve_system(x, rhs, prev_x);
     }
   };
 
@@ -251,15 +662,8 @@ namespace dealii
       this->rhs_matrix_v.vmult_add(rhs, prev_v);
       this->assemble_force(rhs, time, time_step);
 
-      this->extrapolate(u, prev_u);
-      try
-        {
-          this->solver.solve(this->matrix, u, rhs, this->preconditioner);
-        }
-      catch (const SolverControl::NoConvergence &e)
-        {
-          AssertThrow(false, ExcMessage(e.what()));
-        }
+      this->extrapolate(u, prev_u, time);
+      this->solve_system(u, rhs, prev_u);
       unsigned int nt_dofs = AixB.m();
       v                    = 0.0;
       for (unsigned int it = 0; it < this->n_timesteps_at_once; ++it)
@@ -290,4 +694,288 @@ namespace dealii
     FullMatrix<Number> AixG;
     FullMatrix<Number> AixZ;
   };
+
+  /** Explicit leapfrog time stepping for the wave equation M u'' + K u = f.
+   *
+   * The scheme is the central difference method in velocity form
+   *   v_{n+1/2} = v_n + dt/2 M^{-1} (f_n - K u_n),
+   *   u_{n+1}   = u_n + dt v_{n+1/2},
+   *   v_{n+1}   = v_{n+1/2} + dt/2 M^{-1} (f_{n+1} - K u_{n+1}).
+   * The mass operator passed in is expected to be diagonal, e.g. the mass
+   * matrix integrated with the Gauss-Lobatto points of FE_Q (collocation), and
+   * is inverted through get_matrix_diagonal_inverse(). The step size is
+   * limited by the CFL condition dt <= 2 / sqrt(lambda_max(M^{-1} K)).
+   *
+   * The solution is sampled at the temporal nodes of the space-time basis, so
+   * it can be post-processed like the one of TimeIntegratorWave.
+   */
+  template <int dim, typename Number>
+  class TimeIntegratorWaveLeapfrog
+  {
+  public:
+    using VectorType      = VectorT<Number>;
+    using BlockVectorType = BlockVectorT<Number>;
+
+    TimeIntegratorWaveLeapfrog(
+      TimeStepType                                    type,
+      unsigned int                                    time_degree,
+      MatrixFreeOperator<dim, Number> const          &K_,
+      MatrixFreeOperator<dim, Number> const          &M_diagonal,
+      std::function<void(const double, VectorType &)> integrate_rhs_function,
+      unsigned int                                    n_timesteps_at_once_,
+      double const                                    cfl = 0.9)
+      : K(K_)
+      , mass_inverse(M_diagonal.get_matrix_diagonal_inverse())
+      , integrate_rhs_function(integrate_rhs_function)
+      , n_timesteps_at_once(n_timesteps_at_once_)
+    {
+      if (type == TimeStepType::DG)
+        for (auto const &p :
+             QGaussRadau<1>(time_degree + 1, QGaussRadau<1>::EndPoint::right)
+               .get_points())
+          nodes.push_back(p[0]);
+      else
+        {
+          auto const points = QGaussLobatto<1>(time_degree + 1).get_points();
+          for (unsigned int i = 1; i < points.size(); ++i)
+            nodes.push_back(points[i][0]);
+        }
+
+      using ChebyshevType =
+        PreconditionChebyshev<MatrixFreeOperator<dim, Number>,
+                              VectorType,
+                              DiagonalMatrix<VectorType>>;
+      typename ChebyshevType::AdditionalData chebyshev_additional_data;
+      chebyshev_additional_data.preconditioner      = mass_inverse;
+      chebyshev_additional_data.eig_cg_n_iterations = 30;
+      ChebyshevType chebyshev;
+      chebyshev.initialize(K, chebyshev_additional_data);
+
+      VectorType vec;
+      K.initialize_dof_vector(vec);
+      auto const evs = chebyshev.estimate_eigenvalues(vec);
+
+      max_time_step = cfl * 2.0 / std::sqrt(evs.max_eigenvalue_estimate);
+    }
+
+    /** Largest stable step size times the CFL safety factor
+     */
+    double
+    get_max_time_step() const
+    {
+      return max_time_step;
+    }
+
+    /** Number of leapfrog steps needed to cover a slab of n_timesteps_at_once
+     * steps of size time_step, including the sampling at the temporal nodes
+     */
+    unsigned int
+    n_steps_per_slab(double const time_step) const
+    {
+      unsigned int n_steps = 0;
+      double       t       = 0.0;
+      for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+        for (auto const node : nodes)
+          {
+            double const t_node = (it + node) * time_step;
+            n_steps += n_substeps(t_node - t);
+            t = t_node;
+          }
+      return n_steps;
+    }
+
+    void
+    solve(BlockVectorType                    &u,
+          BlockVectorType                    &v,
+          VectorType const                   &prev_u,
+          VectorType const                   &prev_v,
+          [[maybe_unused]] const unsigned int timestep_number,
+          const double                        time,
+          const double                        time_step) const
+    {
+      VectorType u_n(prev_u), v_n(prev_v), a_n, f;
+      K.initialize_dof_vector(a_n);
+      K.initialize_dof_vector(f);
+
+      double t = time;
+      compute_acceleration(a_n, u_n, f, t);
+      n_steps = 0;
+
+      unsigned int const nt_dofs = nodes.size();
+      for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+        for (unsigned int j = 0; j < nt_dofs; ++j)
+          {
+            double const       t_node = time + (it + nodes[j]) * time_step;
+            unsigned int const n_sub  = n_substeps(t_node - t);
+            double const       dt     = (t_node - t) / n_sub;
+            for (unsigned int s = 0; s < n_sub; ++s)
+              {
+                v_n.add(0.5 * dt, a_n);
+                u_n.add(dt, v_n);
+                t += dt;
+                compute_acceleration(a_n, u_n, f, t);
+                v_n.add(0.5 * dt, a_n);
+              }
+            u.block(it * nt_dofs + j) = u_n;
+            v.block(it * nt_dofs + j) = v_n;
+
+            n_steps += n_sub;
+          }
+    }
+
+    unsigned int
+    last_step() const
+    {
+      return n_steps;
+    }
+
+  private:
+    unsigned int
+    n_substeps(double const interval) const
+    {
+      return std::max(
+        1u,
+        static_cast<unsigned int>(std::ceil(interval / max_time_step - 1e-12)));
+    }
+
+    // a = M^{-1} (f(t) - K u)
+    void
+    compute_acceleration(VectorType       &a,
+                         VectorType const &u,
+                         VectorType       &f,
+                         double const      t) const
+    {
+      integrate_rhs_function(t, f);
+      K.vmult(a, u);
+      f -= a;
+      mass_inverse->vmult(a, f);
+    }
+
+    MatrixFreeOperator<dim, Number> const            &K;
+    std::shared_ptr<DiagonalMatrix<VectorType>> const mass_inverse;
+    std::function<void(const double, VectorType &)>   integrate_rhs_function;
+    unsigned int                                      n_timesteps_at_once;
+    std::vector<double>                               nodes;
+    double                                            max_time_step;
+    mutable unsigned int                              n_steps = 0;
+  };
+
+#ifdef LOD_PRECOMPILED_KERNELS
+  // Instantiated in source/gmg.cc
+  extern template MatrixFreeGMG<2, double>::GMG(
+    TimerOutput &,
+    Parameters<2> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<2> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<2>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<double>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<2, double>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<double>>> &,
+    std::unique_ptr<BlockVectorT<double>> &&,
+    std::unique_ptr<BlockVectorT<double>> &&);
+  extern template void
+  MatrixFreeGMG<2, double>::reinit() const;
+  extern template std::unique_ptr<const MatrixFreeGMG<2, double>>
+  MatrixFreeGMG<2, double>::clone(TimerOutput &) const;
+  extern template double
+  MatrixFreeGMG<2, double>::estimate_relaxation(unsigned) const;
+  extern template void
+  MatrixFreeGMG<2, double>::setup_multigrid() const;
+  extern template void
+  MatrixFreeGMG<2, double>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+
+  extern template MatrixFreeGMG<2, float>::GMG(
+    TimerOutput &,
+    Parameters<2> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<2> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<2>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<float>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<2, float>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<float>>> &,
+    std::unique_ptr<BlockVectorT<float>> &&,
+    std::unique_ptr<BlockVectorT<float>> &&);
+  extern template void
+  MatrixFreeGMG<2, float>::reinit() const;
+  extern template std::unique_ptr<const MatrixFreeGMG<2, float>>
+  MatrixFreeGMG<2, float>::clone(TimerOutput &) const;
+  extern template double
+  MatrixFreeGMG<2, float>::estimate_relaxation(unsigned) const;
+  extern template void
+  MatrixFreeGMG<2, float>::setup_multigrid() const;
+  extern template void
+  MatrixFreeGMG<2, float>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+  extern template void
+  MatrixFreeGMG<2, float>::vmult<BlockVectorT<float>>(
+    BlockVectorT<float> &,
+    const BlockVectorT<float> &) const;
+
+  extern template MatrixFreeGMG<3, double>::GMG(
+    TimerOutput &,
+    Parameters<3> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<3> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<3>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<double>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<3, double>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<double>>> &,
+    std::unique_ptr<BlockVectorT<double>> &&,
+    std::unique_ptr<BlockVectorT<double>> &&);
+  extern template void
+  MatrixFreeGMG<3, double>::reinit() const;
+  extern template std::unique_ptr<const MatrixFreeGMG<3, double>>
+  MatrixFreeGMG<3, double>::clone(TimerOutput &) const;
+  extern template double
+  MatrixFreeGMG<3, double>::estimate_relaxation(unsigned) const;
+  extern template void
+  MatrixFreeGMG<3, double>::setup_multigrid() const;
+  extern template void
+  MatrixFreeGMG<3, double>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+
+  extern template MatrixFreeGMG<3, float>::GMG(
+    TimerOutput &,
+    Parameters<3> const &,
+    unsigned int const,
+    unsigned int const,
+    const std::vector<TimeMGType> &,
+    const DoFHandler<3> &,
+    const MGLevelObject<std::shared_ptr<const DoFHandler<3>>> &,
+    const MGLevelObject<std::shared_ptr<const AffineConstraints<float>>> &,
+    const MGLevelObject<
+      std::shared_ptr<const MatrixFreeSystemMatrix<3, float>>> &,
+    const MGLevelObject<std::shared_ptr<PreconditionVanka<float>>> &,
+    std::unique_ptr<BlockVectorT<float>> &&,
+    std::unique_ptr<BlockVectorT<float>> &&);
+  extern template void
+  MatrixFreeGMG<3, float>::reinit() const;
+  extern template std::unique_ptr<const MatrixFreeGMG<3, float>>
+  MatrixFreeGMG<3, float>::clone(TimerOutput &) const;
+  extern template double
+  MatrixFreeGMG<3, float>::estimate_relaxation(unsigned) const;
+  extern template void
+  MatrixFreeGMG<3, float>::setup_multigrid() const;
+  extern template void
+  MatrixFreeGMG<3, float>::vmult<BlockVectorT<double>>(
+    BlockVectorT<double> &,
+    const BlockVectorT<double> &) const;
+  extern template void
+  MatrixFreeGMG<3, float>::vmult<BlockVectorT<float>>(
+    BlockVectorT<float> &,
+    const BlockVectorT<float> &) const;
+#endif
 } // namespace dealii
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+#pragma once
+
+#include <deal.II/base/mpi.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace dealii
+{
+  /** Recorder of a timeline in the Chrome trace event format, which can be
+   * loaded in Perfetto or chrome://tracing. Events are only recorded after
+   * enable(). The clocks of the ranks are aligned by a barrier in enable(),
+   * the process id of an event is the MPI rank and the thread id counts the
+   * threads in the order of their first event. Names and categories have to
+   * be string literals, they are stored as pointers.
+   */
+  class TraceRecorder
+  {
+  public:
+    static TraceRecorder &
+    instance()
+    {
+      static TraceRecorder recorder;
+      return recorder;
+    }
+
+    void
+    enable(MPI_Comm const comm)
+    {
+      rank = Utilities::MPI::this_mpi_process(comm);
+      events.clear();
+      Utilities::MPI::barrier(comm);
+      start   = std::chrono::steady_clock::now();
+      enabled = true;
+    }
+
+    bool
+    is_enabled() const
+    {
+      return enabled;
+    }
+
+    // Time since enable() in microseconds
+    double
+    now() const
+    {
+      return std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+    }
+
+    void
+    begin(char const *name, char const *category, int const level = -1)
+    {
+      add({name, category, 'B', now(), 0.0, thread_id(), level});
+    }
+
+    void
+    end(char const *name, char const *category, int const level = -1)
+    {
+      add({name, category, 'E', now(), 0.0, thread_id(), level});
+    }
+
+    // Event from begin to end, both given by now()
+    void
+    complete(char const  *name,
+             char const  *category,
+             double const begin,
+             double const end)
+    {
+      add({name, category, 'X', begin, end - begin, thread_id(), -1});
+    }
+
+    /** Write the events and stop recording. With merge, rank 0 writes the
+     * events of all ranks to file_name. Otherwise, each rank writes its
+     * events to file_name with the rank inserted before the extension.
+     */
+    void
+    write(std::string const &file_name, bool const merge, MPI_Comm const comm)
+    {
+      enabled = false;
+      std::ostringstream out;
+      for (unsigned int i = 0; i < events.size(); ++i)
+        {
+          auto const &e = events[i];
+          out << (i == 0 ? "" : ",\n") << "{\"name\":\"" << e.name
+              << "\",\"cat\":\"" << e.category << "\",\"ph\":\"" << e.phase
+              << "\",\"ts\":" << e.time << ",\"pid\":" << rank
+              << ",\"tid\":" << e.thread;
+          if (e.phase == 'X')
+            out << ",\"dur\":" << e.duration;
+          if (e.level >= 0)
+            out << ",\"args\":{\"level\":" << e.level << "}";
+          out << "}";
+        }
+      events.clear();
+
+      std::string name = file_name;
+      if (!merge)
+        {
+          auto const dot = name.rfind(".json");
+          name.insert(dot == std::string::npos ? name.size() : dot,
+                      "." + std::to_string(rank));
+        }
+      std::vector<std::string> const ranks =
+        merge ? Utilities::MPI::gather(comm, out.str(), 0) :
+                std::vector<std::string>{out.str()};
+      if (merge && rank != 0)
+        return;
+
+      std::ofstream file(name);
+      file << "{\"traceEvents\":[\n";
+      bool first = true;
+      for (auto const &events_of_rank : ranks)
+        if (!events_of_rank.empty())
+          {
+            file << (first ? "" : ",\n") << events_of_rank;
+            first = false;
+          }
+      file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+  private:
+    struct Event
+    {
+      char const  *name;
+      char const  *category;
+      char         phase;
+      double       time;
+      double       duration;
+      unsigned int thread;
+      int          level;
+    };
+
+    void
+    add(Event const &event)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      events.push_back(event);
+    }
+
+    static unsigned int
+    thread_id()
+    {
+      static std::atomic<unsigned int> n_threads(0);
+      thread_local unsigned int const  id = n_threads++;
+      return id;
+    }
+
+    bool                                  enabled = false;
+    unsigned int                          rank    = 0;
+    std::chrono::steady_clock::time_point start;
+    std::vector<Event>                    events;
+    std::mutex                            mutex;
+  };
+
+  /** Event for the lifetime of this object, if tracing is enabled
+   */
+  class TraceScope
+  {
+  public:
+    TraceScope(char const *name, char const *category, int const level = -1)
+      : name(TraceRecorder::instance().is_enabled() ? name : nullptr)
+      , category(category)
+      , level(level)
+    {
+      if (this->name)
+        TraceRecorder::instance().begin(name, category, level);
+    }
+
+    ~TraceScope()
+    {
+      if (name)
+        TraceRecorder::instance().end(name, category, level);
+    }
+
+  private:
+    char const *name;
+    char const *category;
+    int const   level;
+  };
+} // namespace dealii
@@ -22,3 +22,30 @@ enum class ProblemType : unsigned int
 };
 static std::unordered_map<std::string, ProblemType> const str_to_problem_type =
   {{"heat", ProblemType::heat}, {"wave", ProblemType::wave}};
+
+enum class WaveIntegratorType : unsigned int
+{
+  space_time = 1,
+  leapfrog   = 2,
+  automatic  = 3,
+};
+static std::unordered_map<std::string, WaveIntegratorType> const
+  str_to_wave_integrator_type = {{"spaceTime", WaveIntegratorType::space_time},
+                                 {"leapfrog", WaveIntegratorType::leapfrog},
+                                 {"auto", WaveIntegratorType::automatic}};
+
+enum class SlabSolverType : unsigned int
+{
+  fgmres     = 1,
+  richardson = 2,
+  idr        = 3,
+  bicgstab   = 4,
+  refinement = 5,
+};
+static std::unordered_map<std::string, SlabSolverType> const
+  str_to_slab_solver_type = {
+    {"FGMRES", SlabSolverType::fgmres},
+    {"Richardson", SlabSolverType::richardson},
+    {"IDR", SlabSolverType::idr},
+    {"BiCGStab", SlabSolverType::bicgstab},
+    {"IterativeRefinement", SlabSolverType::refinement}};
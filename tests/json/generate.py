@@ -33,6 +33,17 @@ def run_instance(options, subdivisions, source_point, lower_left, upper_right):
     datastore["distortGrid"] = options.distortGrid
     datastore["distortCoeff"] = options.distortCoeff
     datastore["endTime"] = options.endTime
+    datastore["coefficientVelocity"] = options.coefficientVelocity or ",".join(["0.0"] * options.dim)
+    datastore["smootherUpdateThreshold"] = options.smootherUpdateThreshold
+    datastore["nestedIteration"] = options.nestedIteration
+    datastore["renumberDofs"] = options.renumberDofs
+    datastore["floatGeometry"] = options.floatGeometry
+    datastore["preconditionDouble"] = options.preconditionDouble
+    datastore["leanSetup"] = options.leanSetup
+    datastore["waveIntegrator"] = options.waveIntegrator
+    datastore["leapfrogCfl"] = options.leapfrogCfl
+    datastore["leapfrogIterationsEstimate"] = options.leapfrogIterationsEstimate
+    datastore["reactionCoefficient"] = options.reactionCoefficient
     datastore["subdivisions"] = subdivisions
     datastore["sourcePoint"] = source_point
     datastore["hyperRectLowerLeft"] = lower_left
@@ -46,6 +57,40 @@ def run_instance(options, subdivisions, source_point, lower_left, upper_right):
     datastore["coarseGridReltol"] = options.coarseGridReltol
     datastore["restrictIsTransposeProlongate"] = options.restrictIsTransposeProlongate
     datastore["variable"] = options.variable
+    datastore["levelSmoothingSteps"] = options.levelSmoothingSteps
+    datastore["levelDamping"] = options.levelDamping
+    datastore["levelSmoother"] = options.levelSmoother
+    datastore["chebyshevSmoothingRange"] = options.chebyshevSmoothingRange
+    datastore["floatVankaInverses"] = options.floatVankaInverses
+    datastore["vankaLuSolve"] = options.vankaLuSolve
+    datastore["tuneSmoothers"] = options.tuneSmoothers
+    datastore["tuneSmoothingSteps"] = options.tuneSmoothingSteps
+    datastore["tuneDamping"] = options.tuneDamping
+    datastore["tuneSmootherTypes"] = options.tuneSmootherTypes
+    datastore["tunedSmoothersFile"] = options.tunedSmoothersFile
+    datastore["printMgHierarchy"] = options.printMgHierarchy
+    datastore["checkClone"] = options.checkClone
+    datastore["mgImbalanceThreshold"] = options.mgImbalanceThreshold
+    datastore["traceFile"] = options.traceFile
+    datastore["traceMerge"] = not options.traceSplit
+    datastore["tuneTimestepsAtOnce"] = options.tuneTimestepsAtOnce
+    datastore["tuneTimestepsAtOnceMax"] = options.tuneTimestepsAtOnceMax
+    datastore["tuneSlabs"] = options.tuneSlabs
+    datastore["adaptiveTimeDegree"] = options.adaptiveTimeDegree
+    datastore["adaptiveTimeDegreeMin"] = options.adaptiveTimeDegreeMin
+    datastore["timeDegreeRefineTol"] = options.timeDegreeRefineTol
+    datastore["timeDegreeCoarsenTol"] = options.timeDegreeCoarsenTol
+    datastore["newtonMaxIterations"] = options.newtonMaxIterations
+    datastore["newtonAbstol"] = options.newtonAbstol
+    datastore["newtonReltol"] = options.newtonReltol
+    datastore["newtonLinearReltol"] = options.newtonLinearReltol
+    datastore["newtonRebuildFactor"] = options.newtonRebuildFactor
+    datastore["slabSolver"] = options.slabSolver
+    datastore["richardsonStallRate"] = options.richardsonStallRate
+    datastore["idrS"] = options.idrS
+    datastore["floatKrylovBasis"] = options.floatKrylovBasis
+    datastore["refinementInnerReltol"] = options.refinementInnerReltol
+    datastore["fullMultigridStart"] = options.fullMultigridStart
 
     unique_id = generate_hash(datastore)
     filename = f"./{options.testName}_{unique_id}.json"
@@ -79,6 +124,17 @@ def parseArguments():
     parser.add_argument("--distortGrid", type=float, default=0.0);
     parser.add_argument("--distortCoeff", type=float, default=0.0);
     parser.add_argument("--endTime", type=float, default=1.0);
+    parser.add_argument("--coefficientVelocity", default=None);
+    parser.add_argument("--smootherUpdateThreshold", type=float, default=0.1);
+    parser.add_argument("--nestedIteration", action="store_true");
+    parser.add_argument("--renumberDofs", action="store_true");
+    parser.add_argument("--floatGeometry", action="store_true");
+    parser.add_argument("--preconditionDouble", action="store_true");
+    parser.add_argument("--leanSetup", action="store_true");
+    parser.add_argument("--waveIntegrator", default="spaceTime");
+    parser.add_argument("--leapfrogCfl", type=float, default=0.9);
+    parser.add_argument("--leapfrogIterationsEstimate", type=float, default=10.0);
+    parser.add_argument("--reactionCoefficient", type=float, default=0.0);
     parser.add_argument("--smoothingDegree", type=int, default=5);
     parser.add_argument("--smoothingSteps", type=int, default=1);
     parser.add_argument("--estimateRelaxation", action="store_true");
@@ -88,6 +144,40 @@ def parseArguments():
     parser.add_argument("--coarseGridReltol", type=float, default=1.e-4);
     parser.add_argument("--restrictIsTransposeProlongate", action="store_true");
     parser.add_argument("--variable", action="store_true");
+    parser.add_argument("--levelSmoothingSteps", default="");
+    parser.add_argument("--levelDamping", default="");
+    parser.add_argument("--levelSmoother", default="");
+    parser.add_argument("--chebyshevSmoothingRange", type=float, default=20.0);
+    parser.add_argument("--floatVankaInverses", action="store_true");
+    parser.add_argument("--vankaLuSolve", action="store_true");
+    parser.add_argument("--tuneSmoothers", action="store_true");
+    parser.add_argument("--tuneSmoothingSteps", default="1, 2, 3");
+    parser.add_argument("--tuneDamping", default="0.8, 1, 1.2");
+    parser.add_argument("--tuneSmootherTypes", default="vanka");
+    parser.add_argument("--tunedSmoothersFile", default="");
+    parser.add_argument("--printMgHierarchy", action="store_true");
+    parser.add_argument("--checkClone", action="store_true");
+    parser.add_argument("--mgImbalanceThreshold", type=float, default=1.2);
+    parser.add_argument("--traceFile", default="");
+    parser.add_argument("--traceSplit", action="store_true");
+    parser.add_argument("--tuneTimestepsAtOnce", action="store_true");
+    parser.add_argument("--tuneTimestepsAtOnceMax", type=int, default=8);
+    parser.add_argument("--tuneSlabs", type=int, default=2);
+    parser.add_argument("--adaptiveTimeDegree", action="store_true");
+    parser.add_argument("--adaptiveTimeDegreeMin", type=int, default=1);
+    parser.add_argument("--timeDegreeRefineTol", type=float, default=1.e-2);
+    parser.add_argument("--timeDegreeCoarsenTol", type=float, default=1.e-4);
+    parser.add_argument("--newtonMaxIterations", type=int, default=20);
+    parser.add_argument("--newtonAbstol", type=float, default=1.e-12);
+    parser.add_argument("--newtonReltol", type=float, default=1.e-8);
+    parser.add_argument("--newtonLinearReltol", type=float, default=1.e-4);
+    parser.add_argument("--newtonRebuildFactor", type=float, default=2.0);
+    parser.add_argument("--slabSolver", default="FGMRES");
+    parser.add_argument("--richardsonStallRate", type=float, default=0.9);
+    parser.add_argument("--idrS", type=int, default=2);
+    parser.add_argument("--floatKrylovBasis", action="store_true");
+    parser.add_argument("--refinementInnerReltol", type=float, default=1.e-3);
+    parser.add_argument("--fullMultigridStart", action="store_true");
 
     arguments = parser.parse_args()
     return arguments
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+// Check that the MPI wrappers are linked and count the ghost exchange of a
+// distributed vector for the kernel of the enclosing scope
+
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include "include/communication.h"
+
+#include <iostream>
+
+using namespace dealii;
+
+int
+main(int argc, char **argv)
+{
+  Utilities::MPI::MPI_InitFinalize mpi(argc, argv, 1);
+
+  MPI_Comm const     comm    = MPI_COMM_WORLD;
+  unsigned int const rank    = Utilities::MPI::this_mpi_process(comm);
+  unsigned int const n_ranks = Utilities::MPI::n_mpi_processes(comm);
+
+  // Each rank owns 10 entries and ghosts the first entry of the next rank
+  unsigned int const n_local = 10;
+  IndexSet           owned(n_local * n_ranks), ghosts(n_local * n_ranks);
+  owned.add_range(rank * n_local, (rank + 1) * n_local);
+  ghosts.add_index(((rank + 1) % n_ranks) * n_local);
+  LinearAlgebra::distributed::Vector<double> vec(owned, ghosts, comm);
+  vec = 1.0;
+
+  communication_counters().fill(CommunicationCounter());
+  {
+    CommunicationScope scope(CommunicationKernel::matvec);
+    vec.update_ghost_values();
+  }
+  auto const counter = communication_counters()[static_cast<unsigned int>(
+    CommunicationKernel::matvec)];
+
+  unsigned long long const n_messages =
+    Utilities::MPI::sum(counter.n_messages, comm);
+  unsigned long long const n_bytes = Utilities::MPI::sum(counter.n_bytes, comm);
+  if (rank == 0)
+    std::cout << "Ghost exchange counted for matvec: messages "
+              << (n_messages > 0 ? "yes" : "no") << ", bytes "
+              << (n_bytes > 0 ? "yes" : "no") << std::endl;
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+// Copyright (C) 2024 by Nils Margenberg and Peter Munch
+
+// Check the Richardson slab solver on A = diag(1, ..., 20): with the exact
+// inverse as preconditioner it converges in one iteration, with a weak one
+// it stalls and FGMRES reaches the reduction of the initial residual
+
+#include <deal.II/base/logstream.h>
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/diagonal_matrix.h>
+#include <deal.II/lac/solver_fgmres.h>
+
+#include "include/solvers.h"
+
+#include <iostream>
+
+using namespace dealii;
+
+int
+main(int argc, char **argv)
+{
+  Utilities::MPI::MPI_InitFinalize mpi(argc, argv, 1);
+  deallog.depth_console(0);
+
+  using BlockVectorType = BlockVectorT<double>;
+  unsigned int const n  = 20;
+
+  DiagonalMatrix<BlockVectorType> A, exact, weak;
+  for (auto *matrix : {&A, &exact, &weak})
+    matrix->get_vector().reinit(1, n);
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      A.get_vector().block(0)[i]     = i + 1.0;
+      exact.get_vector().block(0)[i] = 1.0 / (i + 1.0);
+      weak.get_vector().block(0)[i]  = 1e-3;
+    }
+
+  BlockVectorType x(1, n), b(1, n), r(1, n);
+  b = 1.0;
+
+  {
+    ReductionControl                       control(100, 1e-14, 1e-10);
+    SolverRichardsonStall<BlockVectorType> richardson(control, 0.9);
+    bool const converged = richardson.solve(A, x, b, exact);
+    std::cout << "Exact preconditioner: converged "
+              << (converged ? "yes" : "no") << " after "
+              << richardson.last_step() << " iteration(s)" << std::endl;
+  }
+
+  x = 0.0;
+  {
+    ReductionControl                       control(100, 1e-14, 1e-10);
+    SolverRichardsonStall<BlockVectorType> richardson(control, 0.9);
+    bool const stalled = !richardson.solve(A, x, b, weak);
+    std::cout << "Weak preconditioner: stalled " << (stalled ? "yes" : "no")
+              << " after " << richardson.last_step() << " iteration(s)"
+              << std::endl;
+
+    SolverControl fallback_control = richardson.fallback_control();
+
+    SolverFGMRES<BlockVectorType> fgmres(fallback_control);
+    fgmres.solve(A, x, b, weak);
+
+    A.vmult(r, x);
+    r.sadd(-1.0, 1.0, b);
+    std::cout << "FGMRES fallback: reduction 1e-10 reached "
+              << (r.l2_norm() <= 1e-10 * b.l2_norm() ? "yes" : "no")
+              << ", iteration limit " << fallback_control.max_steps()
+              << std::endl;
+  }
+}
@@ -10,6 +10,8 @@
 #include <deal.II/distributed/repartitioning_policy_tools.h>
 #include <deal.II/distributed/tria.h>
 
+#include <deal.II/dofs/dof_renumbering.h>
+
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_tools.h>
 
@@ -37,6 +39,56 @@ convert_to(FullMatrix<Number_src> const &in)
   return out;
 }
 
+/** Slab solutions of one run of the convergence study. They provide the
+ * initial guesses for the run on the next refinement (nested iteration).
+ * There, the time step is halved, so each slab is covered by one slab of
+ * this run, whose solution is evaluated at the temporal nodes and then
+ * prolongated in space.
+ */
+template <int dim, typename Number>
+struct SolutionHistory
+{
+  int                                                         refinement = -1;
+  int                                                         fe_degree  = -1;
+  double                                                      time_step  = 0.0;
+  std::shared_ptr<parallel::distributed::Triangulation<dim>> tria;
+  std::shared_ptr<DoFHandler<dim>>                            dof_handler;
+  AffineConstraints<Number>                                   constraints;
+  std::vector<BlockVectorT<Number>>                           x;
+  std::vector<VectorT<Number>>                                prev_x;
+
+  // Value at time t, for the temporal nodes at the right end of a step the
+  // limit from the left
+  void
+  evaluate(VectorT<Number>                                    &dst,
+           double const                                        t,
+           std::vector<Polynomials::Polynomial<double>> const &basis,
+           bool const                                          is_cgp) const
+  {
+    unsigned int const nt_dofs = is_cgp ? basis.size() - 1 : basis.size();
+    unsigned int const n_steps = x.front().n_blocks() / nt_dofs;
+    unsigned int const step    = std::clamp<int>(
+      std::ceil(t / time_step - 1e-10) - 1, 0, x.size() * n_steps - 1);
+    double const tau = t / time_step - step;
+
+    auto const        &x_s = x[step / n_steps];
+    unsigned int const it  = step % n_steps;
+    dst                    = 0.0;
+    for (unsigned int i = 0; i < basis.size(); ++i)
+      {
+        double const v = basis[i].value(tau);
+        if (!is_cgp)
+          dst.add(v, x_s.block(it * nt_dofs + i));
+        else if (i > 0)
+          dst.add(v, x_s.block(it * nt_dofs + i - 1));
+        else
+          dst.add(v,
+                  it == 0 ? prev_x[step / n_steps] :
+                            x_s.block(it * nt_dofs - 1));
+      }
+  }
+};
+
 template <typename Number, typename NumberPreconditioner = Number>
 void
 test(dealii::ConditionalOStream &pcout,
@@ -52,10 +104,14 @@ test(dealii::ConditionalOStream &pcout,
   std::visit([&](auto &p) { p.parse(file_name); }, parameters);
   ConvergenceTable table;
   ConvergenceTable itable;
+  std::tuple<SolutionHistory<2, Number>, SolutionHistory<3, Number>> histories;
 
+  // Returns the wall time per unit of simulated time. With n_trial_slabs > 0,
+  // only that many slabs are solved and nothing is reported.
   auto convergence_test = [&]<int dim>(int const              refinement,
                                        int const              fe_degree,
-                                       Parameters<dim> const &parameters) {
+                                       Parameters<dim> const &parameters,
+                                       unsigned int const n_trial_slabs = 0) {
     const bool print_timing      = parameters.print_timing;
     const bool space_time_mg     = parameters.space_time_mg;
     const bool time_before_space = parameters.time_before_space;
@@ -63,6 +119,8 @@ test(dealii::ConditionalOStream &pcout,
     Assert(parameters.fe_degree >= (is_cgp ? 1 : 0),
            ExcLowerRange(parameters.fe_degree, (is_cgp ? 1 : 0)));
     Assert(parameters.refinement >= 1, ExcLowerRange(parameters.refinement, 1));
+    if (!parameters.trace_file.empty())
+      TraceRecorder::instance().enable(comm_global);
 
     MappingQ1<dim>     mapping;
     bool const         do_output           = parameters.do_output;
@@ -77,8 +135,12 @@ test(dealii::ConditionalOStream &pcout,
     FE_Q<dim>   fe(fe_degree + 1);
     QGauss<dim> quad(fe.tensor_degree() + 1);
 
-    parallel::distributed::Triangulation<dim> tria(comm_global);
-    DoFHandler<dim>                           dof_handler(tria);
+    // Kept alive beyond this run for the nested iteration
+    auto tria_ptr =
+      std::make_shared<parallel::distributed::Triangulation<dim>>(comm_global);
+    auto dof_handler_ptr = std::make_shared<DoFHandler<dim>>(*tria_ptr);
+    auto &tria           = *tria_ptr;
+    auto &dof_handler    = *dof_handler_ptr;
 
     GridGenerator::subdivided_hyper_rectangle(tria,
                                               parameters.subdivisions,
@@ -92,12 +154,27 @@ test(dealii::ConditionalOStream &pcout,
     dof_handler.distribute_dofs(fe);
 
     AffineConstraints<Number> constraints;
-    IndexSet                  locally_relevant_dofs;
-    DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_dofs);
-    constraints.reinit(locally_relevant_dofs);
-    DoFTools::make_hanging_node_constraints(dof_handler, constraints);
-    DoFTools::make_zero_boundary_constraints(dof_handler, constraints);
-    constraints.close();
+    auto const                make_constraints = [&]() {
+      IndexSet locally_relevant_dofs;
+      DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                              locally_relevant_dofs);
+      constraints.clear();
+      constraints.reinit(locally_relevant_dofs);
+      DoFTools::make_hanging_node_constraints(dof_handler, constraints);
+      DoFTools::make_zero_boundary_constraints(dof_handler, constraints);
+      constraints.close();
+    };
+    make_constraints();
+    // Number the DoFs in the order MatrixFree visits the cells. The levels
+    // use the same settings, so that the finest level keeps the numbering.
+    typename MatrixFree<dim, Number>::AdditionalData const renumber_data;
+    if (parameters.renumber_dofs)
+      {
+        DoFRenumbering::matrix_free_data_locality(dof_handler,
+                                                  constraints,
+                                                  renumber_data);
+        make_constraints();
+      }
     pcout << ":: Number of active cells: " << tria.n_global_active_cells()
           << "\n"
           << ":: Number of degrees of freedom: " << dof_handler.n_dofs()
@@ -130,11 +207,18 @@ test(dealii::ConditionalOStream &pcout,
     Coefficient<dim> coeff(parameters);
     // matrix-free operators
     MatrixFreeOperator<dim, Number> K_mf(
-      mapping, dof_handler, constraints, quad, 0.0, 1.0);
+      mapping, dof_handler, constraints, quad, 0.0, 1.0, parameters.lean_setup);
     MatrixFreeOperator<dim, Number> M_mf(
-      mapping, dof_handler, constraints, quad, 1.0, 0.0);
+      mapping, dof_handler, constraints, quad, 1.0, 0.0, parameters.lean_setup);
     if (!parameters.space_time_conv_test)
       K_mf.evaluate_coefficient(coeff);
+    bool const time_dependent_coefficient =
+      !parameters.space_time_conv_test && coeff.is_time_dependent();
+    if (parameters.float_geometry)
+      {
+        K_mf.set_float_geometry(true);
+        M_mf.set_float_geometry(true);
+      }
 
     if (false)
       {
@@ -197,169 +281,6 @@ test(dealii::ConditionalOStream &pcout,
       std::make_unique<SystemMatrix<Number, MatrixFreeOperator<dim, Number>>>(
         timer, K_mf, M_mf, rhs_uK, rhs_uM);
 
-    /// GMG
-    RepartitioningPolicyTools::DefaultPolicy<dim>          policy(true);
-    std::vector<std::shared_ptr<const Triangulation<dim>>> mg_triangulations =
-      MGTransferGlobalCoarseningTools::create_geometric_coarsening_sequence(
-        tria, policy);
-    unsigned int fe_degree_min =
-      space_time_mg ? parameters.fe_degree_min : fe_degree;
-    unsigned int n_timesteps_min =
-      space_time_mg ? std::max(parameters.n_timesteps_at_once_min, 1) :
-                      n_timesteps_at_once;
-    std::vector<TimeMGType> mg_type_level =
-      get_time_mg_sequence(mg_triangulations.size(),
-                           fe_degree,
-                           fe_degree_min,
-                           n_timesteps_at_once,
-                           n_timesteps_min,
-                           TimeMGType::k,
-                           time_before_space);
-    mg_triangulations =
-      get_space_time_triangulation(mg_type_level, mg_triangulations);
-
-
-    const unsigned int min_level = 0;
-    const unsigned int max_level = mg_triangulations.size() - 1;
-    pcout << ":: Min Level " << min_level << "  Max Level " << max_level
-          << "\n";
-    MGLevelObject<std::shared_ptr<const DoFHandler<dim>>> mg_dof_handlers(
-      min_level, max_level);
-    MGLevelObject<
-      std::shared_ptr<const MatrixFreeOperator<dim, NumberPreconditioner>>>
-      mg_M_mf(min_level, max_level);
-    MGLevelObject<
-      std::shared_ptr<const MatrixFreeOperator<dim, NumberPreconditioner>>>
-      mg_K_mf(min_level, max_level);
-    MGLevelObject<
-      std::shared_ptr<const AffineConstraints<NumberPreconditioner>>>
-      mg_constraints(min_level, max_level);
-    MGLevelObject<std::shared_ptr<
-      const SystemMatrix<NumberPreconditioner,
-                         MatrixFreeOperator<dim, NumberPreconditioner>>>>
-      mg_operators(min_level, max_level);
-    MGLevelObject<std::shared_ptr<PreconditionVanka<NumberPreconditioner>>>
-      precondition_vanka(min_level, max_level);
-    std::vector<std::array<FullMatrix<NumberPreconditioner>, 4>> fetw;
-    std::vector<std::array<FullMatrix<NumberPreconditioner>, 5>> fetw_w;
-    if (parameters.problem == ProblemType::heat)
-      fetw =
-        get_fe_time_weights<Number, NumberPreconditioner>(parameters.type,
-                                                          fe_degree,
-                                                          time_step_size,
-                                                          n_timesteps_at_once,
-                                                          mg_type_level);
-    else if (parameters.problem == ProblemType::wave)
-      fetw_w = get_fe_time_weights_wave<Number, NumberPreconditioner>(
-        parameters.type,
-        fe_degree,
-        time_step_size,
-        n_timesteps_at_once,
-        mg_type_level);
-
-    for (unsigned int l = min_level; l <= max_level; ++l)
-      {
-        auto dof_handler_ =
-          std::make_shared<DoFHandler<dim>>(*mg_triangulations[l]);
-        auto constraints_ =
-          std::make_shared<AffineConstraints<NumberPreconditioner>>();
-        dof_handler_->distribute_dofs(fe);
-
-        IndexSet locally_relevant_dofs;
-        DoFTools::extract_locally_relevant_dofs(*dof_handler_,
-                                                locally_relevant_dofs);
-        constraints_->reinit(locally_relevant_dofs);
-        DoFTools::make_zero_boundary_constraints(*dof_handler_,
-                                                 0,
-                                                 *constraints_);
-        constraints_->close();
-
-        // matrix-free operators
-        auto K_mf_ =
-          std::make_shared<MatrixFreeOperator<dim, NumberPreconditioner>>(
-            mapping, *dof_handler_, *constraints_, quad, 0.0, 1.0);
-        auto M_mf_ =
-          std::make_shared<MatrixFreeOperator<dim, NumberPreconditioner>>(
-            mapping, *dof_handler_, *constraints_, quad, 1.0, 0.0);
-        if (!parameters.space_time_conv_test)
-          K_mf_->evaluate_coefficient(coeff);
-
-        auto const &lhs_uK_p =
-          parameters.problem == ProblemType::heat ? fetw[l][0] : fetw_w[l][0];
-        auto const &lhs_uM_p =
-          parameters.problem == ProblemType::heat ? fetw[l][1] : fetw_w[l][1];
-
-        mg_operators[l] = std::make_shared<
-          SystemMatrix<NumberPreconditioner,
-                       MatrixFreeOperator<dim, NumberPreconditioner>>>(
-          timer, *K_mf_, *M_mf_, lhs_uK_p, lhs_uM_p);
-
-        auto sparsity_pattern_ = std::make_shared<SparsityPatternType>(
-          dof_handler_->locally_owned_dofs(),
-          dof_handler_->locally_owned_dofs(),
-          dof_handler_->get_communicator());
-        DoFTools::make_sparsity_pattern(*dof_handler_,
-                                        *sparsity_pattern_,
-                                        *constraints_,
-                                        false);
-        sparsity_pattern_->compress();
-
-        auto K_ = std::make_shared<SparseMatrixType>();
-        K_->reinit(*sparsity_pattern_);
-        auto M_ = std::make_shared<SparseMatrixType>();
-        M_->reinit(*sparsity_pattern_);
-        K_mf_->compute_system_matrix(*K_);
-        M_mf_->compute_system_matrix(*M_);
-
-        // matrix->attach(*mg_operators[l]);
-        mg_M_mf[l]         = M_mf_;
-        mg_K_mf[l]         = K_mf_;
-        mg_dof_handlers[l] = dof_handler_;
-        mg_constraints[l]  = constraints_;
-        precondition_vanka[l] =
-          std::make_shared<PreconditionVanka<NumberPreconditioner>>(
-            timer,
-            K_,
-            M_,
-            sparsity_pattern_,
-            lhs_uK_p,
-            lhs_uM_p,
-            mg_dof_handlers[l]);
-      }
-
-
-
-    // std::shared_ptr<MGSmootherBase<BlockVectorType>> smoother =
-    //   std::make_shared<MGSmootherIdentity<BlockVectorType>>();
-    std::unique_ptr<BlockVectorT<NumberPreconditioner>> tmp1, tmp2;
-    if (!std::is_same_v<Number, NumberPreconditioner>)
-      {
-        tmp1 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
-        tmp2 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
-        matrix->initialize_dof_vector(*tmp1);
-        matrix->initialize_dof_vector(*tmp2);
-      }
-    using Preconditioner =
-      GMG<dim,
-          NumberPreconditioner,
-          SystemMatrix<NumberPreconditioner,
-                       MatrixFreeOperator<dim, NumberPreconditioner>>>;
-    auto preconditioner = std::make_unique<Preconditioner>(timer,
-                                                           parameters,
-                                                           fe_degree,
-                                                           n_timesteps_at_once,
-                                                           mg_type_level,
-                                                           dof_handler,
-                                                           mg_dof_handlers,
-                                                           mg_constraints,
-                                                           mg_operators,
-                                                           precondition_vanka,
-                                                           std::move(tmp1),
-                                                           std::move(tmp2));
-    preconditioner->reinit();
-    //
-    /// GMG
-
     std::unique_ptr<Function<dim, Number>> rhs_function;
     std::unique_ptr<Function<dim, Number>> exact_solution, exact_solution_v;
     if (parameters.space_time_conv_test)
@@ -396,6 +317,596 @@ test(dealii::ConditionalOStream &pcout,
         VectorTools::create_right_hand_side(
           mapping, dof_handler, quad, *rhs_function, rhs, constraints);
     };
+
+    // Explicit leapfrog engine for the wave problem. It needs a diagonal mass
+    // matrix, which we get by collocation in the Gauss-Lobatto points of FE_Q.
+    bool const is_nonlinear = parameters.reaction_coefficient != 0.0;
+    AssertThrow(!is_nonlinear ||
+                  parameters.wave_integrator != WaveIntegratorType::leapfrog,
+                ExcMessage("The leapfrog integrator is linear only"));
+    bool use_leapfrog = false;
+    std::unique_ptr<MatrixFreeOperator<dim, Number>>         M_diagonal_mf;
+    std::unique_ptr<TimeIntegratorWaveLeapfrog<dim, Number>> leapfrog;
+    if (parameters.problem == ProblemType::wave && !is_nonlinear &&
+        parameters.wave_integrator != WaveIntegratorType::space_time)
+      {
+        M_diagonal_mf = std::make_unique<MatrixFreeOperator<dim, Number>>(
+          mapping,
+          dof_handler,
+          constraints,
+          QGaussLobatto<dim>(fe.tensor_degree() + 1),
+          1.0,
+          0.0,
+          parameters.lean_setup);
+        leapfrog = std::make_unique<TimeIntegratorWaveLeapfrog<dim, Number>>(
+          parameters.type,
+          fe_degree,
+          K_mf,
+          *M_diagonal_mf,
+          integrate_rhs_function,
+          n_timesteps_at_once,
+          parameters.leapfrog_cfl);
+
+        unsigned int const n_leapfrog_steps =
+          leapfrog->n_steps_per_slab(time_step_size);
+        use_leapfrog =
+          parameters.wave_integrator == WaveIntegratorType::leapfrog;
+        if (parameters.wave_integrator == WaveIntegratorType::automatic)
+          {
+            // Compare the work per slab in units of the measured time of a
+            // spatial operator application and a right-hand side evaluation.
+            // For the space-time solve we assume a fixed number of FGMRES
+            // iterations, each applying the space-time matrix (K and M on
+            // every block) and one V-cycle. A smoothing step costs about two
+            // operator applications for the residual and two for Vanka, the
+            // coarser levels add 1/(2^dim - 1) of the fine level work. The
+            // right-hand side is evaluated once per block. Each leapfrog
+            // step applies K once and evaluates the right-hand side once.
+            VectorType u, f;
+            K_mf.initialize_dof_vector(u);
+            K_mf.initialize_dof_vector(f);
+            u                        = 1.0;
+            unsigned int const n_rep = 5;
+            auto               start = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < n_rep; ++i)
+              K_mf.vmult(f, u);
+            auto const time_of = [&](auto const begin) {
+              return Utilities::MPI::max(
+                std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - begin)
+                    .count() /
+                  n_rep,
+                comm_global);
+            };
+            double const time_operator = time_of(start);
+            start                      = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < n_rep; ++i)
+              integrate_rhs_function(0.0, f);
+            double const time_rhs = time_of(start);
+
+            double const level_factor =
+              std::pow(2.0, dim) / (std::pow(2.0, dim) - 1.0);
+            double const cost_space_time =
+              parameters.leapfrog_iterations_estimate * n_blocks *
+                (2.0 + level_factor * 2.0 * 4.0 *
+                         parameters.mg_data.smoothing_steps) *
+                time_operator +
+              n_blocks * time_rhs;
+            double const cost_leapfrog =
+              (n_leapfrog_steps + 1) * (time_operator + time_rhs);
+            use_leapfrog = cost_leapfrog < cost_space_time;
+          }
+        pcout << ":: Leapfrog time step " << leapfrog->get_max_time_step()
+              << " (" << n_leapfrog_steps << " steps per slab)\n"
+              << ":: Wave integrator: "
+              << (use_leapfrog ? "leapfrog" : "space-time") << "\n";
+        if (!use_leapfrog)
+          {
+            leapfrog.reset();
+            M_diagonal_mf.reset();
+          }
+      }
+
+    using Preconditioner =
+      GMG<dim,
+          NumberPreconditioner,
+          SystemMatrix<NumberPreconditioner,
+                       MatrixFreeOperator<dim, NumberPreconditioner>>>;
+    std::unique_ptr<Preconditioner> preconditioner;
+    // The level operators reference these, so they have to outlive the setup
+    MGLevelObject<
+      std::shared_ptr<MatrixFreeOperator<dim, NumberPreconditioner>>>
+      mg_M_mf, mg_K_mf;
+    std::vector<std::array<FullMatrix<NumberPreconditioner>, 4>> fetw;
+    std::vector<std::array<FullMatrix<NumberPreconditioner>, 5>> fetw_w;
+    MGLevelObject<std::shared_ptr<PreconditionVanka<NumberPreconditioner>>>
+      precondition_vanka;
+    // Level time weights of the linear problem. The Newton solver adds the
+    // linearized reaction to copies of them.
+    std::vector<FullMatrix<NumberPreconditioner>> mg_lhs_uM_linear;
+    // Vanka patches and level sparsity patterns, kept to update the smoothers
+    // for a time-dependent coefficient
+    MGLevelObject<std::shared_ptr<VankaPatchData<NumberPreconditioner>>>
+      mg_patches;
+    MGLevelObject<std::shared_ptr<const SparsityPatternType>>
+      mg_sparsity_patterns;
+    // Adaptive time degree: slabs with a degree below fe_degree are solved
+    // with a variant that has its own time weights, space-time operators and
+    // multigrid hierarchy. The spatial levels are shared with the hierarchy
+    // of fe_degree.
+    bool const adaptive_time_degree =
+      parameters.adaptive_time_degree && !use_leapfrog;
+    AssertThrow(!adaptive_time_degree ||
+                  (!is_nonlinear && !time_dependent_coefficient),
+                ExcMessage("The adaptive time degree is only implemented for "
+                           "linear problems with a constant coefficient"));
+    unsigned int const time_degree_max = fe_degree;
+    unsigned int const time_degree_min =
+      std::min(parameters.adaptive_time_degree_min, time_degree_max);
+    struct TimeDegreeVariant
+    {
+      std::array<FullMatrix<Number>, 4> weights_1;
+      FullMatrix<Number> lhs_uK, lhs_uM, rhs_uK, rhs_uM, rhs_vM, zero;
+      std::unique_ptr<SystemMatrix<Number, MatrixFreeOperator<dim, Number>>>
+        matrix, rhs_matrix, rhs_matrix_v;
+      std::vector<std::array<FullMatrix<NumberPreconditioner>, 4>> fetw;
+      std::vector<std::array<FullMatrix<NumberPreconditioner>, 5>> fetw_w;
+      std::unique_ptr<Preconditioner> preconditioner;
+      std::unique_ptr<TimeIntegrator<dim, Number, Preconditioner>> step;
+      // Values of the basis at the temporal nodes of fe_degree
+      FullMatrix<Number> embedding;
+      BlockVectorType    x, v;
+    };
+    std::map<unsigned int, TimeDegreeVariant> time_degree_variants;
+
+    bool const keep_cell_matrices =
+      is_nonlinear || time_dependent_coefficient || adaptive_time_degree;
+    if (!use_leapfrog)
+      {
+        /// GMG
+        RepartitioningPolicyTools::DefaultPolicy<dim> policy(true);
+        std::vector<std::shared_ptr<const Triangulation<dim>>> const
+          mg_space_triangulations = MGTransferGlobalCoarseningTools::
+            create_geometric_coarsening_sequence(tria, policy);
+        unsigned int fe_degree_min =
+          space_time_mg ? parameters.fe_degree_min : fe_degree;
+        unsigned int n_timesteps_min =
+          space_time_mg ? std::max(parameters.n_timesteps_at_once_min, 1) :
+                          n_timesteps_at_once;
+        std::vector<TimeMGType> mg_type_level =
+          get_time_mg_sequence(mg_space_triangulations.size(),
+                               fe_degree,
+                               fe_degree_min,
+                               n_timesteps_at_once,
+                               n_timesteps_min,
+                               TimeMGType::k,
+                               time_before_space);
+        std::vector<std::shared_ptr<const Triangulation<dim>>>
+          mg_triangulations = get_space_time_triangulation(
+            mg_type_level, mg_space_triangulations);
+
+
+        const unsigned int min_level = 0;
+        const unsigned int max_level = mg_triangulations.size() - 1;
+        pcout << ":: Min Level " << min_level << "  Max Level " << max_level
+              << "\n";
+        MGLevelObject<std::shared_ptr<const DoFHandler<dim>>> mg_dof_handlers(
+          min_level, max_level);
+        mg_M_mf.resize(min_level, max_level);
+        mg_K_mf.resize(min_level, max_level);
+        MGLevelObject<
+          std::shared_ptr<const AffineConstraints<NumberPreconditioner>>>
+          mg_constraints(min_level, max_level);
+        MGLevelObject<std::shared_ptr<
+          const SystemMatrix<NumberPreconditioner,
+                             MatrixFreeOperator<dim, NumberPreconditioner>>>>
+          mg_operators(min_level, max_level);
+        precondition_vanka.resize(min_level, max_level);
+        // Levels that are configured for Chebyshev never apply Vanka unless
+        // the tuning may pick it, so their inverses are not computed
+        auto const uses_vanka = [&](unsigned int const level) {
+          auto const        &smoothers = parameters.mg_data.level_smoother;
+          unsigned int const i         = level - min_level;
+          return parameters.tune_smoothers || i >= smoothers.size() ||
+                 smoothers[i] != "chebyshev";
+        };
+        if (time_dependent_coefficient || adaptive_time_degree)
+          mg_patches.resize(min_level, max_level);
+        if (time_dependent_coefficient)
+          mg_sparsity_patterns.resize(min_level, max_level);
+        if (parameters.problem == ProblemType::heat || is_nonlinear)
+          fetw = get_fe_time_weights<Number, NumberPreconditioner>(
+            parameters.type,
+            fe_degree,
+            time_step_size,
+            n_timesteps_at_once,
+            mg_type_level);
+        if (parameters.problem == ProblemType::wave)
+          fetw_w = get_fe_time_weights_wave<Number, NumberPreconditioner>(
+            parameters.type,
+            fe_degree,
+            time_step_size,
+            n_timesteps_at_once,
+            mg_type_level);
+
+        // Consecutive levels that differ only in time (k or tau coarsening)
+        // share the triangulation and thus all spatial objects. Only the time
+        // weights and the space-time Vanka inverses are set up per level.
+        std::shared_ptr<DoFHandler<dim>>                         dof_handler_;
+        std::shared_ptr<AffineConstraints<NumberPreconditioner>> constraints_;
+        std::shared_ptr<MatrixFreeOperator<dim, NumberPreconditioner>> K_mf_,
+          M_mf_;
+        std::shared_ptr<VankaPatchData<NumberPreconditioner>> patches_;
+        std::shared_ptr<SparsityPatternType>                  sparsity_pattern_;
+        for (unsigned int l = min_level; l <= max_level; ++l)
+          {
+            if (l == min_level ||
+                mg_triangulations[l] != mg_triangulations[l - 1])
+              {
+                // The Newton solver and the coefficient updates rebuild the
+                // Vanka inverses
+                if (patches_ && !keep_cell_matrices)
+                  patches_->clear_cell_matrices();
+
+                dof_handler_ =
+                  std::make_shared<DoFHandler<dim>>(*mg_triangulations[l]);
+                constraints_ =
+                  std::make_shared<AffineConstraints<NumberPreconditioner>>();
+                dof_handler_->distribute_dofs(fe);
+
+                auto const make_level_constraints = [&]() {
+                  IndexSet locally_relevant_dofs;
+                  DoFTools::extract_locally_relevant_dofs(
+                    *dof_handler_, locally_relevant_dofs);
+                  constraints_->clear();
+                  constraints_->reinit(locally_relevant_dofs);
+                  DoFTools::make_zero_boundary_constraints(*dof_handler_,
+                                                           0,
+                                                           *constraints_);
+                  constraints_->close();
+                };
+                make_level_constraints();
+                if (parameters.renumber_dofs)
+                  {
+                    DoFRenumbering::matrix_free_data_locality(*dof_handler_,
+                                                              *constraints_,
+                                                              renumber_data);
+                    make_level_constraints();
+                  }
+
+                // matrix-free operators
+                K_mf_ = std::make_shared<
+                  MatrixFreeOperator<dim, NumberPreconditioner>>(
+                    mapping,
+                    *dof_handler_,
+                    *constraints_,
+                    quad,
+                    0.0,
+                    1.0,
+                    parameters.lean_setup);
+                M_mf_ = std::make_shared<
+                  MatrixFreeOperator<dim, NumberPreconditioner>>(
+                    mapping,
+                    *dof_handler_,
+                    *constraints_,
+                    quad,
+                    1.0,
+                    0.0,
+                    parameters.lean_setup);
+                if (!parameters.space_time_conv_test)
+                  K_mf_->evaluate_coefficient(coeff);
+
+                sparsity_pattern_ = std::make_shared<SparsityPatternType>(
+                  dof_handler_->locally_owned_dofs(),
+                  dof_handler_->locally_owned_dofs(),
+                  dof_handler_->get_communicator());
+                DoFTools::make_sparsity_pattern(*dof_handler_,
+                                                *sparsity_pattern_,
+                                                *constraints_,
+                                                false);
+                sparsity_pattern_->compress();
+
+                auto K_ = std::make_shared<SparseMatrixType>();
+                K_->reinit(*sparsity_pattern_);
+                auto M_ = std::make_shared<SparseMatrixType>();
+                M_->reinit(*sparsity_pattern_);
+                K_mf_->compute_system_matrix(*K_);
+                M_mf_->compute_system_matrix(*M_);
+
+                // Vanka patches in the cell batch order of MatrixFree
+                std::vector<typename DoFHandler<dim>::cell_iterator>
+                  cell_order;
+                if (parameters.renumber_dofs)
+                  {
+                    auto const &mf = K_mf_->get_matrix_free();
+                    for (unsigned int b = 0; b < mf.n_cell_batches(); ++b)
+                      for (unsigned int v = 0;
+                           v < mf.n_active_entries_per_cell_batch(b);
+                           ++v)
+                        cell_order.push_back(mf.get_cell_iterator(b, v));
+                  }
+                patches_ =
+                  std::make_shared<VankaPatchData<NumberPreconditioner>>(
+                    K_,
+                    M_,
+                    sparsity_pattern_,
+                    std::shared_ptr<const DoFHandler<dim>>(dof_handler_),
+                    cell_order);
+              }
+
+            auto const &lhs_uK_p = parameters.problem == ProblemType::heat ?
+                                     fetw[l][0] :
+                                     fetw_w[l][0];
+            auto const &lhs_uM_p = parameters.problem == ProblemType::heat ?
+                                     fetw[l][1] :
+                                     fetw_w[l][1];
+
+            mg_operators[l] = std::make_shared<
+              SystemMatrix<NumberPreconditioner,
+                           MatrixFreeOperator<dim, NumberPreconditioner>>>(
+              timer, *K_mf_, *M_mf_, lhs_uK_p, lhs_uM_p);
+
+            // matrix->attach(*mg_operators[l]);
+            mg_M_mf[l]         = M_mf_;
+            mg_K_mf[l]         = K_mf_;
+            mg_dof_handlers[l] = dof_handler_;
+            mg_constraints[l]  = constraints_;
+            precondition_vanka[l] =
+              uses_vanka(l) ?
+                std::make_shared<PreconditionVanka<NumberPreconditioner>>(
+                  timer,
+                  patches_,
+                  lhs_uK_p,
+                  lhs_uM_p,
+                  parameters.mg_data.vanka_lu_solve) :
+                std::make_shared<PreconditionVanka<NumberPreconditioner>>(
+                  timer);
+            if (is_nonlinear)
+              mg_lhs_uM_linear.push_back(lhs_uM_p);
+            if (time_dependent_coefficient || adaptive_time_degree)
+              mg_patches[l] = patches_;
+            if (time_dependent_coefficient)
+              mg_sparsity_patterns[l] = sparsity_pattern_;
+          }
+        if (!keep_cell_matrices)
+          patches_->clear_cell_matrices();
+
+
+
+        // std::shared_ptr<MGSmootherBase<BlockVectorType>> smoother =
+        //   std::make_shared<MGSmootherIdentity<BlockVectorType>>();
+        std::unique_ptr<BlockVectorT<NumberPreconditioner>> tmp1, tmp2;
+        if (!std::is_same_v<Number, NumberPreconditioner>)
+          {
+            tmp1 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
+            tmp2 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
+            matrix->initialize_dof_vector(*tmp1);
+            matrix->initialize_dof_vector(*tmp2);
+          }
+        preconditioner = std::make_unique<Preconditioner>(timer,
+                                                          parameters,
+                                                          fe_degree,
+                                                          n_timesteps_at_once,
+                                                          mg_type_level,
+                                                          dof_handler,
+                                                          mg_dof_handlers,
+                                                          mg_constraints,
+                                                          mg_operators,
+                                                          precondition_vanka,
+                                                          std::move(tmp1),
+                                                          std::move(tmp2));
+        preconditioner->reinit();
+        if (parameters.print_mg_hierarchy)
+          preconditioner->print_hierarchy(pcout,
+                                          parameters.mg_imbalance_threshold);
+        if (parameters.tune_smoothers)
+          {
+            preconditioner->tune_smoothers(parameters.tune_smoothing_steps,
+                                           parameters.tune_damping,
+                                           parameters.tune_smoother_types);
+            auto const &mg_data = preconditioner->get_additional_data();
+            pcout << "Tuned smoothers (smoother, steps, damping):";
+            for (unsigned int i = 0; i < mg_data.level_damping.size(); ++i)
+              pcout << " (" << mg_data.level_smoother[i] << ", "
+                    << mg_data.level_smoothing_steps[i] << ", "
+                    << mg_data.level_damping[i] << ")";
+            pcout << std::endl;
+            if (!parameters.tuned_smoothers_file.empty() &&
+                Utilities::MPI::this_mpi_process(comm_global) == 0)
+              Parameters<dim>::write_smoother_settings(
+                file_name, parameters.tuned_smoothers_file, mg_data);
+          }
+        if (parameters.check_clone)
+          {
+            // The clone shares the hierarchy data and has to reproduce the
+            // V-cycle of the original
+            TimerOutput clone_timer(pcout,
+                                    TimerOutput::never,
+                                    TimerOutput::wall_times);
+            auto const  clone = preconditioner->clone(clone_timer);
+            BlockVectorType src(n_blocks), dst(n_blocks), dst_clone(n_blocks);
+            for (unsigned int i = 0; i < n_blocks; ++i)
+              {
+                matrix->initialize_dof_vector(src.block(i));
+                matrix->initialize_dof_vector(dst.block(i));
+                matrix->initialize_dof_vector(dst_clone.block(i));
+                src.block(i) = 1.0;
+                constraints.set_zero(src.block(i));
+              }
+            preconditioner->vmult(dst, src);
+            clone->vmult(dst_clone, src);
+            dst_clone -= dst;
+            pcout << "Clone matches the preconditioner: "
+                  << (dst_clone.l2_norm() <= 1e-6 * dst.l2_norm() ? "yes" :
+                                                                    "no")
+                  << std::endl;
+          }
+
+        // Variants of lower time degree. Each level uses the spatial objects
+        // of the first level above with the same triangulation.
+        Quadrature<1> const time_nodes =
+          is_cgp ? Quadrature<1>(QGaussLobatto<1>(fe_degree + 1)) :
+                   Quadrature<1>(QGaussRadau<1>(
+                     fe_degree + 1, QGaussRadau<1>::EndPoint::right));
+        for (unsigned int d = time_degree_min;
+             adaptive_time_degree && d < time_degree_max;
+             ++d)
+          {
+            auto &variant = time_degree_variants[d];
+            std::vector<TimeMGType> const mg_type_level_d =
+              get_time_mg_sequence(mg_space_triangulations.size(),
+                                   d,
+                                   std::min(fe_degree_min, d),
+                                   n_timesteps_at_once,
+                                   n_timesteps_min,
+                                   TimeMGType::k,
+                                   time_before_space);
+            auto const mg_triangulations_d =
+              get_space_time_triangulation(mg_type_level_d,
+                                           mg_space_triangulations);
+            bool const is_heat = parameters.problem == ProblemType::heat;
+            if (is_heat)
+              variant.fetw = get_fe_time_weights<Number, NumberPreconditioner>(
+                parameters.type,
+                d,
+                time_step_size,
+                n_timesteps_at_once,
+                mg_type_level_d);
+            else
+              variant.fetw_w =
+                get_fe_time_weights_wave<Number, NumberPreconditioner>(
+                  parameters.type,
+                  d,
+                  time_step_size,
+                  n_timesteps_at_once,
+                  mg_type_level_d);
+
+            unsigned int const max_level_d = mg_triangulations_d.size() - 1;
+            MGLevelObject<std::shared_ptr<const DoFHandler<dim>>>
+              mg_dof_handlers_d(min_level, max_level_d);
+            MGLevelObject<
+              std::shared_ptr<const AffineConstraints<NumberPreconditioner>>>
+              mg_constraints_d(min_level, max_level_d);
+            MGLevelObject<std::shared_ptr<const SystemMatrix<
+              NumberPreconditioner,
+              MatrixFreeOperator<dim, NumberPreconditioner>>>>
+              mg_operators_d(min_level, max_level_d);
+            MGLevelObject<
+              std::shared_ptr<PreconditionVanka<NumberPreconditioner>>>
+              precondition_vanka_d(min_level, max_level_d);
+            for (unsigned int l = min_level, p = min_level; l <= max_level_d;
+                 ++l)
+              {
+                while (p <= max_level &&
+                       mg_triangulations[p] != mg_triangulations_d[l])
+                  ++p;
+                AssertThrow(p <= max_level, ExcInternalError());
+                auto const &lhs_uK_p =
+                  is_heat ? variant.fetw[l][0] : variant.fetw_w[l][0];
+                auto const &lhs_uM_p =
+                  is_heat ? variant.fetw[l][1] : variant.fetw_w[l][1];
+                mg_operators_d[l] = std::make_shared<
+                  SystemMatrix<NumberPreconditioner,
+                               MatrixFreeOperator<dim, NumberPreconditioner>>>(
+                  timer, *mg_K_mf[p], *mg_M_mf[p], lhs_uK_p, lhs_uM_p);
+                mg_dof_handlers_d[l] = mg_dof_handlers[p];
+                mg_constraints_d[l]  = mg_constraints[p];
+                precondition_vanka_d[l] =
+                  uses_vanka(l) ?
+                    std::make_shared<PreconditionVanka<NumberPreconditioner>>(
+                      timer,
+                      mg_patches[p],
+                      lhs_uK_p,
+                      lhs_uM_p,
+                      parameters.mg_data.vanka_lu_solve) :
+                    std::make_shared<PreconditionVanka<NumberPreconditioner>>(
+                      timer);
+              }
+
+            // space-time operators of the slab
+            variant.weights_1 = get_fe_time_weights<Number>(parameters.type,
+                                                            d,
+                                                            time_step_size,
+                                                            1);
+            auto [Alpha_d, Beta_d, Gamma_d, Zeta_d] =
+              get_fe_time_weights<Number>(parameters.type,
+                                          d,
+                                          time_step_size,
+                                          n_timesteps_at_once);
+            variant.zero.reinit(Gamma_d.m(), Gamma_d.n());
+            if (is_heat)
+              {
+                variant.lhs_uK = Alpha_d;
+                variant.lhs_uM = Beta_d;
+                variant.rhs_uK = is_cgp ? Gamma_d : variant.zero;
+                variant.rhs_uM = is_cgp ? Zeta_d : Gamma_d;
+              }
+            else
+              {
+                auto [Alpha_lhs, Beta_lhs, rhs_uK_, rhs_uM_, rhs_vM_] =
+                  get_fe_time_weights_wave(parameters.type,
+                                           variant.weights_1[0],
+                                           variant.weights_1[1],
+                                           variant.weights_1[2],
+                                           variant.weights_1[3],
+                                           n_timesteps_at_once);
+                variant.lhs_uK       = Alpha_lhs;
+                variant.lhs_uM       = Beta_lhs;
+                variant.rhs_uK       = rhs_uK_;
+                variant.rhs_uM       = rhs_uM_;
+                variant.rhs_vM       = rhs_vM_;
+                variant.rhs_matrix_v = std::make_unique<
+                  SystemMatrix<Number, MatrixFreeOperator<dim, Number>>>(
+                  timer, K_mf, M_mf, variant.zero, variant.rhs_vM);
+              }
+            variant.matrix = std::make_unique<
+              SystemMatrix<Number, MatrixFreeOperator<dim, Number>>>(
+              timer, K_mf, M_mf, variant.lhs_uK, variant.lhs_uM);
+            variant.rhs_matrix = std::make_unique<
+              SystemMatrix<Number, MatrixFreeOperator<dim, Number>>>(
+              timer, K_mf, M_mf, variant.rhs_uK, variant.rhs_uM);
+
+            std::unique_ptr<BlockVectorT<NumberPreconditioner>> tmp1, tmp2;
+            if (!std::is_same_v<Number, NumberPreconditioner>)
+              {
+                tmp1 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
+                tmp2 = std::make_unique<BlockVectorT<NumberPreconditioner>>();
+                variant.matrix->initialize_dof_vector(*tmp1);
+                variant.matrix->initialize_dof_vector(*tmp2);
+              }
+            variant.preconditioner =
+              std::make_unique<Preconditioner>(timer,
+                                               parameters,
+                                               d,
+                                               n_timesteps_at_once,
+                                               mg_type_level_d,
+                                               dof_handler,
+                                               mg_dof_handlers_d,
+                                               mg_constraints_d,
+                                               mg_operators_d,
+                                               precondition_vanka_d,
+                                               std::move(tmp1),
+                                               std::move(tmp2));
+            variant.preconditioner->reinit();
+
+            auto const basis_d = get_time_basis(parameters.type, d);
+            variant.embedding.reinit(time_nodes.size(), basis_d.size());
+            for (unsigned int j = 0; j < time_nodes.size(); ++j)
+              for (unsigned int i = 0; i < basis_d.size(); ++i)
+                variant.embedding(j, i) =
+                  basis_d[i].value(time_nodes.point(j)[0]);
+          }
+        if (adaptive_time_degree)
+          {
+            for (unsigned int l = min_level; l <= max_level; ++l)
+              if (l == min_level || mg_patches[l] != mg_patches[l - 1])
+                mg_patches[l]->clear_cell_matrices();
+            pcout << ":: Adaptive time degree " << time_degree_min << " to "
+                  << time_degree_max << "\n";
+          }
+        /// GMG
+      }
+
     auto evaluate_exact_solution = [&mapping,
                                     &dof_handler,
                                     &exact_solution,
@@ -514,7 +1025,7 @@ test(dealii::ConditionalOStream &pcout,
         integrate_rhs_function,
         n_timesteps_at_once,
         parameters.extrapolate);
-    else
+    else if (!use_leapfrog)
       step = std::make_unique<TimeIntegratorWave<dim, Number, Preconditioner>>(
         parameters.type,
         fe_degree,
@@ -531,6 +1042,195 @@ test(dealii::ConditionalOStream &pcout,
         n_timesteps_at_once,
         parameters.extrapolate);
 
+    if (step)
+      {
+        step->set_slab_solver(parameters.slab_solver_data);
+        step->set_inner_matrix(preconditioner->get_fine_matrix());
+        double const n_solver_vectors = step->n_solver_vectors();
+        if (print_timing ||
+            parameters.slab_solver_data.type != SlabSolverType::fgmres ||
+            parameters.slab_solver_data.float_basis)
+          pcout << ":: Slab solver: " << n_solver_vectors
+                << " auxiliary block vectors ("
+                << n_solver_vectors *
+                     Utilities::MPI::sum(x.memory_consumption(),
+                                         MPI_COMM_WORLD) /
+                     (1024.0 * 1024.0)
+                << " MB)\n";
+      }
+
+    for (auto &[d, variant] : time_degree_variants)
+      {
+        unsigned int const n_blocks_d = variant.lhs_uK.m();
+        variant.x.reinit(n_blocks_d);
+        for (unsigned int i = 0; i < n_blocks_d; ++i)
+          matrix->initialize_dof_vector(variant.x.block(i));
+        if (parameters.problem == ProblemType::heat)
+          variant.step =
+            std::make_unique<TimeIntegratorHeat<dim, Number, Preconditioner>>(
+              parameters.type,
+              d,
+              variant.weights_1[0],
+              variant.weights_1[2],
+              1.e-12,
+              *variant.matrix,
+              *variant.preconditioner,
+              *variant.rhs_matrix,
+              integrate_rhs_function,
+              n_timesteps_at_once,
+              parameters.extrapolate);
+        else
+          {
+            variant.v.reinit(n_blocks_d);
+            for (unsigned int i = 0; i < n_blocks_d; ++i)
+              matrix->initialize_dof_vector(variant.v.block(i));
+            variant.step =
+              std::make_unique<TimeIntegratorWave<dim, Number, Preconditioner>>(
+                parameters.type,
+                d,
+                variant.weights_1[0],
+                variant.weights_1[1],
+                variant.weights_1[2],
+                variant.weights_1[3],
+                1.e-12,
+                *variant.matrix,
+                *variant.preconditioner,
+                *variant.rhs_matrix,
+                *variant.rhs_matrix_v,
+                integrate_rhs_function,
+                n_timesteps_at_once,
+                parameters.extrapolate);
+          }
+        variant.step->set_slab_solver(parameters.slab_solver_data);
+        variant.step->set_inner_matrix(
+          variant.preconditioner->get_fine_matrix());
+      }
+
+    // Nested iteration: the run on the previous refinement with the same
+    // degree provides the initial guesses of the slabs, also for the
+    // variants of lower time degree
+    auto &history = std::get<SolutionHistory<dim, Number>>(histories);
+    SolutionHistory<dim, Number>                         next_history;
+    std::unique_ptr<MGTwoLevelTransfer<dim, VectorType>> history_transfer;
+    if (parameters.nested_iteration && step)
+      {
+        if (history.refinement + 1 == refinement &&
+            history.fe_degree == fe_degree)
+          {
+            history_transfer =
+              std::make_unique<MGTwoLevelTransfer<dim, VectorType>>();
+            history_transfer->reinit(dof_handler,
+                                     *history.dof_handler,
+                                     constraints,
+                                     history.constraints);
+            auto const make_initial_guess = [&](unsigned int const degree) {
+              unsigned int const  nt_dofs_d = is_cgp ? degree : degree + 1;
+              std::vector<double> nodes(nt_dofs_d);
+              for (unsigned int j = 0; j < nt_dofs_d; ++j)
+                nodes[j] =
+                  is_cgp ?
+                    QGaussLobatto<1>(degree + 1).point(j + 1)[0] :
+                    QGaussRadau<1>(degree + 1, QGaussRadau<1>::EndPoint::right)
+                      .point(j)[0];
+              return [&, nodes, nt_dofs_d](BlockVectorType &x_,
+                                           double const     time_) {
+                VectorType coarse(history.x.front().block(0));
+                for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+                  for (unsigned int j = 0; j < nt_dofs_d; ++j)
+                    {
+                      history.evaluate(coarse,
+                                       time_ +
+                                         time_step_size * (it + nodes[j]),
+                                       basis,
+                                       is_cgp);
+                      x_.block(it * nt_dofs_d + j) = 0.0;
+                      history_transfer->prolongate_and_add(
+                        x_.block(it * nt_dofs_d + j), coarse);
+                    }
+                return true;
+              };
+            };
+            step->set_initial_guess(make_initial_guess(fe_degree));
+            for (auto &[d, variant] : time_degree_variants)
+              variant.step->set_initial_guess(make_initial_guess(d));
+          }
+        next_history.refinement  = refinement;
+        next_history.fe_degree   = fe_degree;
+        next_history.time_step   = time_step_size;
+        next_history.tria        = tria_ptr;
+        next_history.dof_handler = dof_handler_ptr;
+        next_history.constraints.copy_from(constraints);
+      }
+
+    if (is_nonlinear)
+      {
+        auto reaction = std::make_shared<CubicReactionOperator<dim, Number>>(
+          K_mf.get_matrix_free(), parameters.reaction_coefficient);
+        // Lagged preconditioner: the reaction is linearized around the mean
+        // of g'(u) over the slab, which adds g' Alpha x M to the level
+        // operators. The hierarchy itself is kept, only the level time
+        // weights, the Vanka inverses and the smoothers are updated.
+        auto const rebuild_preconditioner = [&](Number const mean_derivative) {
+          for (unsigned int l = 0; l < mg_lhs_uM_linear.size(); ++l)
+            {
+              bool const is_heat = parameters.problem == ProblemType::heat;
+              auto const &lhs_uK_l = is_heat ? fetw[l][0] : fetw_w[l][0];
+              auto       &lhs_uM_l = is_heat ? fetw[l][1] : fetw_w[l][1];
+              lhs_uM_l             = mg_lhs_uM_linear[l];
+              lhs_uM_l.add(static_cast<NumberPreconditioner>(mean_derivative),
+                           fetw[l][0]);
+              precondition_vanka[l]->reinit(lhs_uK_l, lhs_uM_l);
+            }
+          preconditioner->reinit();
+        };
+        step->set_reaction(reaction,
+                           parameters.newton_data,
+                           rebuild_preconditioner);
+      }
+
+    // Time-dependent coefficient, frozen at the midpoint of each slab. The
+    // coefficient tables of all operators are refreshed for every slab. The
+    // Vanka inverses and the relaxation parameters of the smoothers are only
+    // recomputed once the accumulated relative change exceeds the threshold;
+    // the hierarchy itself is kept.
+    double       coefficient_change    = 0.0;
+    unsigned int n_smoother_updates    = 0;
+    unsigned int n_coefficient_updates = 0;
+    auto const   update_coefficient    = [&](double const t) {
+      coeff.set_time(t);
+      ++n_coefficient_updates;
+      K_mf.update_coefficient(coeff);
+      if (use_leapfrog)
+        return;
+
+      double level_change = 0.0;
+      for (unsigned int l = mg_K_mf.min_level(); l <= mg_K_mf.max_level(); ++l)
+        if (l == mg_K_mf.min_level() || mg_K_mf[l] != mg_K_mf[l - 1])
+          level_change =
+            std::max<double>(level_change,
+                             mg_K_mf[l]->update_coefficient(coeff));
+      coefficient_change += level_change;
+      if (coefficient_change <= parameters.smoother_update_threshold)
+        return;
+
+      bool const is_heat = parameters.problem == ProblemType::heat;
+      for (unsigned int l = mg_K_mf.min_level(); l <= mg_K_mf.max_level(); ++l)
+        {
+          if (l == mg_K_mf.min_level() || mg_patches[l] != mg_patches[l - 1])
+            {
+              SparseMatrixType K_;
+              K_.reinit(*mg_sparsity_patterns[l]);
+              mg_K_mf[l]->compute_system_matrix(K_);
+              mg_patches[l]->update_stiffness(K_, *mg_sparsity_patterns[l]);
+            }
+          precondition_vanka[l]->reinit(is_heat ? fetw[l][0] : fetw_w[l][0],
+                                        is_heat ? fetw[l][1] : fetw_w[l][1]);
+        }
+      preconditioner->reinit();
+      coefficient_change = 0.0;
+      ++n_smoother_updates;
+    };
+
     // interpolate initial value
     evaluate_exact_solution(0, x.block(x.n_blocks() - 1));
     if (parameters.problem == ProblemType::wave)
@@ -539,6 +1239,7 @@ test(dealii::ConditionalOStream &pcout,
     constexpr double qNaN           = std::numeric_limits<double>::quiet_NaN();
     bool const       st_convergence = parameters.space_time_conv_test;
     int              i = 0, total_gmres_iterations = 0;
+    int              total_leapfrog_steps = 0;
 
     unsigned int samples_per_interval = (fe_degree + 1) * (fe_degree + 1);
     double       sample_step          = 1.0 / (samples_per_interval - 1);
@@ -627,30 +1328,155 @@ test(dealii::ConditionalOStream &pcout,
         "./", name, timestep_number, tria.get_communicator(), 4);
     };
 
-    while (time < parameters.end_time)
+    // Write the solution src of a variant into the blocks of fe_degree. This
+    // is exact, since the space of the lower degree is contained in it.
+    auto const embed_time_degree = [&](BlockVectorType         &dst,
+                                       BlockVectorType const   &src,
+                                       VectorType const        &prev,
+                                       TimeDegreeVariant const &variant) {
+      unsigned int const n_basis   = variant.embedding.n();
+      unsigned int const nt_dofs_d = is_cgp ? n_basis - 1 : n_basis;
+      for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+        for (unsigned int j = 0; j < nt_dofs; ++j)
+          {
+            auto &dst_j = dst.block(it * nt_dofs + j);
+            dst_j       = 0.0;
+            for (unsigned int i = 0; i < n_basis; ++i)
+              {
+                Number const value = variant.embedding(j + is_cgp, i);
+                if (value == 0.0)
+                  continue;
+                if (!is_cgp)
+                  dst_j.add(value, src.block(it * nt_dofs_d + i));
+                else if (i > 0)
+                  dst_j.add(value, src.block(it * nt_dofs_d + i - 1));
+                else
+                  dst_j.add(value,
+                            it == 0 ? prev : src.block(it * nt_dofs_d - 1));
+              }
+          }
+    };
+    // Ratio of the Legendre coefficient of degree d to the L2 norm of the
+    // solution in time, as maximum over the time steps of the slab
+    FullMatrix<Number> const legendre = get_time_legendre_matrix<Number>(basis);
+    VectorType               coefficient;
+    matrix->initialize_dof_vector(coefficient);
+    auto const time_degree_indicator = [&](BlockVectorType const &x_,
+                                           VectorType const      &prev_x_,
+                                           unsigned int const     d) {
+      double indicator = 0.0;
+      for (unsigned int it = 0; it < n_timesteps_at_once; ++it)
+        {
+          double highest = 0.0, total = 0.0;
+          for (unsigned int m = 0; m <= d; ++m)
+            {
+              coefficient = 0.0;
+              for (unsigned int i = 0; i < basis.size(); ++i)
+                if (legendre(m, i) != 0.0)
+                  coefficient.add(legendre(m, i),
+                                  !is_cgp ? x_.block(it * nt_dofs + i) :
+                                  i > 0   ? x_.block(it * nt_dofs + i - 1) :
+                                  it == 0 ? prev_x_ :
+                                            x_.block(it * nt_dofs - 1));
+              highest = coefficient.norm_sqr();
+              total += highest;
+            }
+          if (total > 0.0)
+            indicator = std::max(indicator, std::sqrt(highest / total));
+        }
+      return indicator;
+    };
+    unsigned int time_degree       = time_degree_max;
+    unsigned int total_time_degree = 0;
+
+    double const start_time = time;
+    auto const   start      = std::chrono::steady_clock::now();
+    while (time < parameters.end_time &&
+           (n_trial_slabs == 0 || timestep_number < n_trial_slabs))
       {
         TimerOutput::Scope scope(timer, "step");
+        TraceScope         trace("slab", "solver");
 
         ++timestep_number;
         dealii::deallog << "Step " << timestep_number << " t = " << time
                         << std::endl;
         prev_x = x.block(x.n_blocks() - 1);
-        if (parameters.problem == ProblemType::heat)
+        if (parameters.problem == ProblemType::wave)
+          prev_v = v.block(v.n_blocks() - 1);
+        if (time_dependent_coefficient)
+          update_coefficient(time + 0.5 * n_timesteps_at_once * time_step_size);
+        if (time_degree < time_degree_max)
+          {
+            auto &variant = time_degree_variants.at(time_degree);
+            if (parameters.problem == ProblemType::heat)
+              static_cast<
+                TimeIntegratorHeat<dim, Number, Preconditioner> const *>(
+                variant.step.get())
+                ->solve(
+                  variant.x, prev_x, timestep_number, time, time_step_size);
+            else
+              {
+                static_cast<
+                  TimeIntegratorWave<dim, Number, Preconditioner> const *>(
+                  variant.step.get())
+                  ->solve(variant.x,
+                          variant.v,
+                          prev_x,
+                          prev_v,
+                          timestep_number,
+                          time,
+                          time_step_size);
+                embed_time_degree(v, variant.v, prev_v, variant);
+              }
+            embed_time_degree(x, variant.x, prev_x, variant);
+            total_gmres_iterations += variant.step->last_step();
+          }
+        else if (parameters.problem == ProblemType::heat)
           static_cast<TimeIntegratorHeat<dim, Number, Preconditioner> const *>(
             step.get())
             ->solve(x, prev_x, timestep_number, time, time_step_size);
         else
           {
-            prev_v = v.block(v.n_blocks() - 1);
-            static_cast<
-              TimeIntegratorWave<dim, Number, Preconditioner> const *>(
-              step.get())
-              ->solve(
+            if (use_leapfrog)
+              leapfrog->solve(
                 x, v, prev_x, prev_v, timestep_number, time, time_step_size);
+            else
+              static_cast<
+                TimeIntegratorWave<dim, Number, Preconditioner> const *>(
+                step.get())
+                ->solve(
+                  x, v, prev_x, prev_v, timestep_number, time, time_step_size);
           }
-        total_gmres_iterations += step->last_step();
+        if (use_leapfrog)
+          total_leapfrog_steps += leapfrog->last_step();
+        else if (time_degree == time_degree_max)
+          total_gmres_iterations += step->last_step();
         for (unsigned int i = 0; i < n_blocks; ++i)
           constraints.distribute(x.block(i));
+        if (adaptive_time_degree)
+          {
+            double indicator = time_degree_indicator(x, prev_x, time_degree);
+            if (parameters.problem == ProblemType::wave)
+              indicator =
+                std::max(indicator,
+                         time_degree_indicator(v, prev_v, time_degree));
+            dealii::deallog << "Time degree " << time_degree << " indicator "
+                            << indicator << std::endl;
+            total_time_degree += time_degree;
+            // The slab is accepted as solved, the indicator only chooses
+            // the degree of the next slab
+            if (indicator > parameters.time_degree_refine_tol &&
+                time_degree < time_degree_max)
+              ++time_degree;
+            else if (indicator < parameters.time_degree_coarsen_tol &&
+                     time_degree > time_degree_min)
+              --time_degree;
+          }
+        if (next_history.tria)
+          {
+            next_history.x.push_back(x);
+            next_history.prev_x.push_back(prev_x);
+          }
         if (st_convergence)
           {
             auto error_on_In = error_calculator.evaluate_error(
@@ -681,14 +1507,47 @@ test(dealii::ConditionalOStream &pcout,
           }
 #endif
       }
+    double const time_per_unit =
+      Utilities::MPI::max(std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count(),
+                          comm_global) /
+      (time - start_time);
+    if (n_trial_slabs > 0)
+      return time_per_unit;
+
     double average_gmres_iter = static_cast<double>(total_gmres_iterations) /
                                 static_cast<double>(timestep_number);
     pcout << "Average GMRES iterations " << average_gmres_iter << " ("
           << total_gmres_iterations << " gmres_iterations / " << timestep_number
           << " timesteps)\n"
           << std::endl;
+    if (use_leapfrog)
+      pcout << "Average leapfrog steps "
+            << static_cast<double>(total_leapfrog_steps) /
+                 static_cast<double>(timestep_number)
+            << "\n"
+            << std::endl;
+    if (time_dependent_coefficient)
+      pcout << "Smoother updates " << n_smoother_updates << " ("
+            << n_coefficient_updates << " slabs)\n"
+            << std::endl;
+    if (adaptive_time_degree)
+      pcout << "Average time degree "
+            << static_cast<double>(total_time_degree) /
+                 static_cast<double>(timestep_number)
+            << "\n"
+            << std::endl;
     if (print_timing)
-      timer.print_wall_time_statistics(MPI_COMM_WORLD);
+      {
+        timer.print_wall_time_statistics(MPI_COMM_WORLD);
+        print_communication_statistics(pcout, MPI_COMM_WORLD);
+        print_region_markers(pcout, MPI_COMM_WORLD);
+      }
+    if (!parameters.trace_file.empty())
+      TraceRecorder::instance().write(parameters.trace_file,
+                                      parameters.trace_merge,
+                                      comm_global);
 
     auto const   n_active_cells = tria.n_global_active_cells();
     size_t const n_dofs         = static_cast<size_t>(dof_handler.n_dofs());
@@ -703,6 +1562,13 @@ test(dealii::ConditionalOStream &pcout,
     table.add_value("L2-L2", st_convergence ? std::sqrt(l2) : qNaN);
     table.add_value("L2-H1_semi", st_convergence ? std::sqrt(h1_semi) : qNaN);
     itable.add_value(std::to_string(refinement), average_gmres_iter);
+
+    if (parameters.nested_iteration)
+      {
+        history_transfer.reset();
+        history = std::move(next_history);
+      }
+    return time_per_unit;
   };
   auto const [k, d_cyc, r_cyc, r] = std::visit(
     [](auto const &p) {
@@ -713,6 +1579,49 @@ test(dealii::ConditionalOStream &pcout,
     },
     parameters);
 
+  // Solve a few slabs for each power of two up to the given maximum as
+  // number of time steps per slab on the first configuration and keep the
+  // size with the smallest wall time per unit of simulated time. The
+  // configured nTimestepsAtOnceMin is kept, clamped to the tried size.
+  std::visit(
+    [&](auto &p) {
+      if (!p.tune_timesteps_at_once)
+        return;
+      auto         trial_parameters = p;
+      unsigned int best             = p.n_timesteps_at_once;
+      double       best_time        = std::numeric_limits<double>::max();
+      trial_parameters.do_output        = false;
+      trial_parameters.print_timing     = false;
+      trial_parameters.trace_file       = "";
+      trial_parameters.nested_iteration = false;
+      bool const active                 = pcout.is_active();
+      for (unsigned int n = 1; n <= p.tune_timesteps_at_once_max; n *= 2)
+        {
+          trial_parameters.n_timesteps_at_once     = n;
+          trial_parameters.n_timesteps_at_once_min =
+            std::min(p.n_timesteps_at_once_min, static_cast<int>(n));
+          pcout.set_condition(false);
+          double const time_per_unit =
+            convergence_test(r, k, trial_parameters, p.tune_slabs);
+          pcout.set_condition(active);
+          pcout << "nTimestepsAtOnce " << n << ": " << time_per_unit
+                << " s per unit time" << std::endl;
+          dealii::deallog << "nTimestepsAtOnce " << n << ": "
+                          << time_per_unit << " s per unit time"
+                          << std::endl;
+          if (time_per_unit < best_time)
+            {
+              best_time = time_per_unit;
+              best      = n;
+            }
+        }
+      p.n_timesteps_at_once     = best;
+      p.n_timesteps_at_once_min =
+        std::min(p.n_timesteps_at_once_min, static_cast<int>(best));
+      pcout << "Selected nTimestepsAtOnce " << best << "\n" << std::endl;
+    },
+    parameters);
+
   for (unsigned int j = k; j < k + d_cyc; ++j)
     {
       itable.add_value("k \\ r", j);
@@ -746,6 +1655,17 @@ test(dealii::ConditionalOStream &pcout,
   pcout << std::endl;
 }
 
+// The precision of the preconditioner selects the instantiation of test(),
+// so it is read from the parameter file before dispatching
+template <int dim>
+bool
+parse_precondition_double(std::string const &file_name)
+{
+  Parameters<dim> parameters;
+  parameters.parse(file_name);
+  return parameters.precondition_double;
+}
+
 
 
 int
@@ -765,6 +1685,7 @@ main(int argc, char **argv)
   std::string file               = "default";
   int         dim                = 2;
   bool        precondition_float = true;
+  initialize_region_markers();
   {
     namespace arg_t = util::arg_type;
     util::cl_options clo(argc, argv);
@@ -773,7 +1694,10 @@ main(int argc, char **argv)
     clo.insert(precondition_float, "precondition_float", arg_t::none, 'p');
   }
   auto tst = [&](std::string file_name) {
-    if (precondition_float)
+    bool const precondition_double =
+      dim == 2 ? parse_precondition_double<2>(file_name) :
+                 parse_precondition_double<3>(file_name);
+    if (precondition_float && !precondition_double)
       test<double, float>(pcout, comm, file_name, dim);
     else
       test<double, double>(pcout, comm, file_name, dim);
@@ -806,6 +1730,7 @@ main(int argc, char **argv)
     }
   else
     tst(file);
+  finalize_region_markers();
 
   dealii::deallog << std::endl;
   pcout << std::endl;